@@ -1,14 +1,35 @@
 #include "Accelerator\BVHAccel.h"
+#include "Core\Stats.h"
 #include <memory>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <omp.h>
+#include <immintrin.h>
+#include <cstring>
 
 namespace PBR {
 	static long long treeBytes = 0;
-	static long long totalPrimitives = 0;
-	static long long totalLeafNodes = 0;
-	static long long interiorNodes = 0;
-	static long long leafNodes = 0;
+	// нʱ̻߳ͬʱڵ㣬ҪԭӲ
+	static std::atomic<long long> totalPrimitives(0);
+	static std::atomic<long long> totalLeafNodes(0);
+	static std::atomic<long long> interiorNodes(0);
+	static std::atomic<long long> leafNodes(0);
 
-    BVHAccel::~BVHAccel() { free(nodes); }
+	// ͼԪڸֵҺΪ񹹽
+	static constexpr int kParallelBuildMinPrims = 4096;
+	// ͼԪڸֵĽڵ㣬ΧSAHͰͳƲм
+	static constexpr int kParallelBinMinPrims = 64 * 1024;
+
+    BVHAccel::~BVHAccel() {
+		FreeAligned(nodes);
+		FreeAligned(wideNodes4);
+		FreeAligned(wideNodes8);
+		FreeAligned(triBlocks4);
+		FreeAligned(triBlocks8);
+		FreeAligned(motionBounds);
+	}
     struct BVHPrimitiveInfo {
         BVHPrimitiveInfo() {}
         BVHPrimitiveInfo(size_t primitiveNumber, const Bounds3f& bounds)
@@ -53,37 +74,140 @@ namespace PBR {
 		uint8_t axis;          
 		uint8_t pad[1];        
 	};
+	// 32ֽڣڵǡռһ
+	static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode should be 32 bytes");
 
 	BVHAccel::BVHAccel(std::vector<std::shared_ptr<Primitive>> p,
-		int maxPrimsInNode, SplitMethod splitMethod)
+		int maxPrimsInNode, SplitMethod splitMethod, int treeWidth, int triangleBlockWidth)
 		: maxPrimsInNode(std::min(255, maxPrimsInNode)),
 		splitMethod(splitMethod),
+		treeWidth(treeWidth == 4 || treeWidth == 8 ? treeWidth : 2),
+		blockWidth(triangleBlockWidth == 4 || triangleBlockWidth == 8 ? triangleBlockWidth : 0),
 		primitives(std::move(p)) {
+		build();
+	}
+
+	// ͷűƽοڵ㣬ؽʹ
+	void BVHAccel::freeTree() {
+		FreeAligned(nodes);
+		FreeAligned(wideNodes4);
+		FreeAligned(wideNodes8);
+		FreeAligned(triBlocks4);
+		FreeAligned(triBlocks8);
+		FreeAligned(motionBounds);
+		nodes = nullptr;
+		wideNodes4 = nullptr;
+		wideNodes8 = nullptr;
+		triBlocks4 = nullptr;
+		triBlocks8 = nullptr;
+		motionBounds = nullptr;
+		totalNodes = 0;
+		buildCost = 0;
+		meshPrimitives.clear();
+		primitiveRefs.clear();
+	}
+
+	void BVHAccel::build() {
+		freeTree();
 		if (primitives.empty()) return;
+		double tStart = omp_get_wtime();
+
+		// ߳벢ȣÿһΪ
+		// ࿪һSAHָĸز
+		buildThreads = omp_get_max_threads();
+		maxSpawnDepth = buildThreads > 1 ? Log2Int(RoundUpPow2((int32_t)buildThreads)) + 1 : 0;
+
+		// ͼԪչΪεãͼԪռһ
+		meshPrimitives.resize(primitives.size(), nullptr);
+		bool hasMotion = false;
+		for (int i = 0; i < (int)primitives.size(); ++i) {
+			meshPrimitives[i] = dynamic_cast<const TriangleMeshPrimitive*>(primitives[i].get());
+			if (meshPrimitives[i] && meshPrimitives[i]->HasMotion()) hasMotion = true;
+			if (meshPrimitives[i])
+				for (int t = 0; t < meshPrimitives[i]->NumTriangles(); ++t)
+					primitiveRefs.push_back({ i, t });
+			else
+				primitiveRefs.push_back({ i, -1 });
+		}
 
 		// ͼԪʱ洢ΧкprimitiveInfo
-		std::vector<BVHPrimitiveInfo> primitiveInfo(primitives.size());
-		for (size_t i = 0; i < primitives.size(); ++i)
-			primitiveInfo[i] = { i, primitives[i]->WorldBound() };
-
-		// ݹ齨
-		int totalNodes = 0;
-		std::vector<std::shared_ptr<Primitive>> orderedPrims;
-		orderedPrims.reserve(primitives.size());
+		int nPrims = (int)primitiveRefs.size();
+		std::vector<BVHPrimitiveInfo> primitiveInfo(nPrims);
+#pragma omp parallel for schedule(static) num_threads(buildThreads)
+		for (int i = 0; i < nPrims; ++i)
+			primitiveInfo[i] = { (size_t)i, refBound(primitiveRefs[i]) };
+		double tInfo = omp_get_wtime();
+
+		// ݹ齨֮ҪǶײУ
+		// ʱڵڴз䣬ƽɺͷ
+		MemoryArena arena(1024 * 1024);
+		std::atomic<int> nBuildNodes(0);
+		std::vector<PrimitiveRef> orderedPrims(nPrims);
+		int prevNested = omp_get_nested();
+		omp_set_nested(1);
 		BVHBuildNode* root;
-		root = recursiveBuild(primitiveInfo, 0, primitives.size(),
-			&totalNodes, orderedPrims);
+		if (splitMethod == SplitMethod::HLBVH)
+			root = HLBVHBuild(arena, primitiveInfo, &nBuildNodes, orderedPrims);
+		else
+			root = recursiveBuild(arena, primitiveInfo, 0, nPrims,
+				&nBuildNodes, orderedPrims, 0);
+		omp_set_nested(prevNested);
+		double tBuild = omp_get_wtime();
 
 		// ͼԪţȷҶӽڵеͼԪڴġ
-		primitives.swap(orderedPrims);
+		primitiveRefs.swap(orderedPrims);
 		primitiveInfo.resize(0);
 
 		// ıƽ
+		totalNodes = nBuildNodes;
 		treeBytes += totalNodes * sizeof(LinearBVHNode) + sizeof(*this) +
-			primitives.size() * sizeof(primitives[0]);
-		nodes = new LinearBVHNode[totalNodes];
+			primitives.size() * (sizeof(primitives[0]) + sizeof(meshPrimitives[0])) +
+			primitiveRefs.size() * sizeof(PrimitiveRef);
+		nodes = AllocAligned<LinearBVHNode>(totalNodes);
 		int offset = 0;
 		flattenBVHTree(root, &offset);
+		size_t arenaBytes = arena.TotalAllocated();
+		for (const auto& a : buildArenas) arenaBytes += a->TotalAllocated();
+		buildArenas.clear();
+		// ˶İΧйڵڿ˵İΧУ
+		// ʱֵοڵֻһʱ̵ݣʱʹö
+		if (hasMotion) {
+			motionBounds = AllocAligned<Bounds3f>(2 * totalNodes);
+			treeBytes += 2 * totalNodes * sizeof(Bounds3f);
+			updateMotionBounds();
+		}
+		// ѡҶͼԪBVH˳ΪSoAο飨۵֮ǰҶƫƻΪ±꣩
+		else if (blockWidth == 4)
+			triBlocks4 = buildTriangleBlocks<4>(totalNodes);
+		else if (blockWidth == 8)
+			triBlocks8 = buildTriangleBlocks<8>(totalNodes);
+		double tFlatten = omp_get_wtime();
+
+		// ѡѶ۵Ϊ4/8ʱSIMDһβԶӽڵ
+		if (this->treeWidth == 4 && !hasMotion)
+			wideNodes4 = collapseWideTree<4>();
+		else if (this->treeWidth == 8 && !hasMotion)
+			wideNodes8 = collapseWideTree<8>();
+		double tCollapse = omp_get_wtime();
+		// ¼ʱSAHۣRefitݴжǷ˻
+		buildCost = SAHCost();
+
+		// ׶κʱ
+		std::cout << std::fixed << std::setprecision(1)
+			<< "BVH build: " << nPrims << " prims, " << totalNodes << " nodes, "
+			<< buildThreads << " threads | info " << 1000 * (tInfo - tStart)
+			<< " ms, build " << 1000 * (tBuild - tInfo)
+			<< " ms, flatten ";
+		if (triBlocks4 || triBlocks8)
+			std::cout << "+ " << blockWidth << "-wide triangle blocks ";
+		if (hasMotion)
+			std::cout << "+ motion bounds ";
+		std::cout << 1000 * (tFlatten - tBuild);
+		if (wideNodes4 || wideNodes8)
+			std::cout << " ms, collapse to " << this->treeWidth << "-wide "
+				<< 1000 * (tCollapse - tFlatten);
+		std::cout << " ms, total " << 1000 * (tCollapse - tStart) << " ms, build nodes "
+			<< arenaBytes / (1024.f * 1024.f) << " MB" << std::endl;
 	}
 
 	Bounds3f BVHAccel::WorldBound() const {
@@ -93,167 +217,491 @@ namespace PBR {
 		int count = 0;
 		Bounds3f bounds;
 	};
+	constexpr int nBuckets = 12;
+
+	// [start, end)İΧĵΧУͼԪ㹻ʱֿ鲢У
+	// min/maxϲ˳޹أ봮ȫһ
+	static void computeBounds(const std::vector<BVHPrimitiveInfo>& primitiveInfo,
+		int start, int end, int nThreads, Bounds3f* bounds, Bounds3f* centroidBounds) {
+		if (nThreads > 1 && end - start >= kParallelBinMinPrims) {
+			std::vector<Bounds3f> b(nThreads), cb(nThreads);
+#pragma omp parallel num_threads(nThreads)
+			{
+				int t = omp_get_thread_num();
+#pragma omp for schedule(static)
+				for (int i = start; i < end; ++i) {
+					b[t] = Union(b[t], primitiveInfo[i].bounds);
+					cb[t] = Union(cb[t], primitiveInfo[i].centroid);
+				}
+			}
+			for (int t = 0; t < nThreads; ++t) {
+				*bounds = Union(*bounds, b[t]);
+				*centroidBounds = Union(*centroidBounds, cb[t]);
+			}
+			return;
+		}
+		for (int i = start; i < end; ++i) {
+			*bounds = Union(*bounds, primitiveInfo[i].bounds);
+			*centroidBounds = Union(*centroidBounds, primitiveInfo[i].centroid);
+		}
+	}
+
+	// SAHͰͳƣڵÿ߳ͳһݾֲͰٺϲ͡Χȡͬ˳޹أ
+	static void computeBuckets(const std::vector<BVHPrimitiveInfo>& primitiveInfo,
+		int start, int end, int nThreads, const Bounds3f& centroidBounds, int dim,
+		BucketInfo buckets[nBuckets]) {
+		auto bucketIndex = [&](int i) {
+			int b = nBuckets * centroidBounds.Offset(primitiveInfo[i].centroid)[dim];
+			return b == nBuckets ? nBuckets - 1 : b;
+		};
+		if (nThreads > 1 && end - start >= kParallelBinMinPrims) {
+			std::vector<BucketInfo> local(nThreads * nBuckets);
+#pragma omp parallel num_threads(nThreads)
+			{
+				BucketInfo* mine = &local[omp_get_thread_num() * nBuckets];
+#pragma omp for schedule(static)
+				for (int i = start; i < end; ++i) {
+					int b = bucketIndex(i);
+					mine[b].count++;
+					mine[b].bounds = Union(mine[b].bounds, primitiveInfo[i].bounds);
+				}
+			}
+			for (int t = 0; t < nThreads; ++t)
+				for (int b = 0; b < nBuckets; ++b) {
+					buckets[b].count += local[t * nBuckets + b].count;
+					buckets[b].bounds = Union(buckets[b].bounds, local[t * nBuckets + b].bounds);
+				}
+			return;
+		}
+		for (int i = start; i < end; ++i) {
+			int b = bucketIndex(i);
+			buckets[b].count++;
+			buckets[b].bounds = Union(buckets[b].bounds, primitiveInfo[i].bounds);
+		}
+	}
 
-	BVHBuildNode* BVHAccel::recursiveBuild(
-		std::vector<BVHPrimitiveInfo>& primitiveInfo, int start, int end, int* totalNodes,
-		std::vector<std::shared_ptr<Primitive>>& orderedPrims) {
+	// Ҷӽڵ㣺йʱҶӰ˳׷ͼԪ׸ͼԪλǡstart
+	// ֱӰstartдorderedPrimsйҲܵõ봮ȫͬͼԪ˳
+	BVHBuildNode* BVHAccel::createLeaf(BVHBuildNode* node,
+		const std::vector<BVHPrimitiveInfo>& primitiveInfo, int start, int end,
+		const Bounds3f& bounds, std::vector<PrimitiveRef>& orderedPrims) {
+		for (int i = start; i < end; ++i) {
+			int primNum = primitiveInfo[i].primitiveNumber;
+			orderedPrims[i] = primitiveRefs[primNum];
+		}
+		node->InitLeaf(start, end - start, bounds);
+		return node;
+	}
+
+	// ʹöڴأ߳ͬʱһڴϷ
+	MemoryArena& BVHAccel::newBuildArena() {
+		std::lock_guard<std::mutex> lock(buildArenasMutex);
+		buildArenas.emplace_back(new MemoryArena(1024 * 1024));
+		return *buildArenas.back();
+	}
+
+	BVHBuildNode* BVHAccel::recursiveBuild(MemoryArena& arena,
+		std::vector<BVHPrimitiveInfo>& primitiveInfo, int start, int end,
+		std::atomic<int>* totalNodes,
+		std::vector<PrimitiveRef>& orderedPrims, int depth) {
 		//ݹõĵһΪǰʱڵ㡢ڵܰΧ
-		BVHBuildNode* node = new BVHBuildNode;
+		BVHBuildNode* node = arena.Alloc<BVHBuildNode>();
 		(*totalNodes)++;
-		Bounds3f bounds;
-		for (int i = start; i < end; ++i)
-			bounds = Union(bounds, primitiveInfo[i].bounds);
+		// ǰȿõ߳ÿһΪ
+		int nThreads = std::max(1, buildThreads >> std::min(depth, 30));
+		Bounds3f bounds, centroidBounds;
+		computeBounds(primitiveInfo, start, end, nThreads, &bounds, &centroidBounds);
 		int nPrimitives = end - start;
 		//ͼԪΪ1Ҷӽڵ
-		if (nPrimitives == 1) {		
-			int firstPrimOffset = orderedPrims.size();
-			for (int i = start; i < end; ++i) {
-				int primNum = primitiveInfo[i].primitiveNumber;
-				orderedPrims.push_back(primitives[primNum]);
-			}
-			node->InitLeaf(firstPrimOffset, nPrimitives, bounds);
-			return node;
+		if (nPrimitives == 1)
+			return createLeaf(node, primitiveInfo, start, end, bounds, orderedPrims);
+		//ͼԪĵغϣ޷ָҶӽڵ
+		int dim = centroidBounds.MaximumExtent();
+		int mid = (start + end) / 2;
+		if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim])
+			return createLeaf(node, primitiveInfo, start, end, bounds, orderedPrims);
+
+		// ѡָ
+		switch (splitMethod) {
+		case SplitMethod::Middle: {
+			// е㷨ҵĵΧ (centroidBounds)  dim ϵĿռе pmid
+			// ͵
+			float pmid =
+				(centroidBounds.pMin[dim] + centroidBounds.pMax[dim]) / 2;
+			BVHPrimitiveInfo* midPtr = std::partition(
+				&primitiveInfo[start], &primitiveInfo[end - 1] + 1,
+				[dim, pmid](const BVHPrimitiveInfo& pi) {
+				return pi.centroid[dim] < pmid;
+			});
+			mid = midPtr - &primitiveInfo[0];
+			// ͼԪеͬ-ַ
+			if (mid != start && mid != end) break;
 		}
-		else {
-			//ͼԪĵغϣ޷ָҶӽڵ
-			Bounds3f centroidBounds;
-			for (int i = start; i < end; ++i)
-				centroidBounds = Union(centroidBounds, primitiveInfo[i].centroid);
-			int dim = centroidBounds.MaximumExtent();
-			int mid = (start + end) / 2;
-			if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim]) {
-				int firstPrimOffset = orderedPrims.size();
-				for (int i = start; i < end; ++i) {
-					int primNum = primitiveInfo[i].primitiveNumber;
-					orderedPrims.push_back(primitives[primNum]);
-				}
-				node->InitLeaf(firstPrimOffset, nPrimitives, bounds);
-				return node;
+		case SplitMethod::EqualCounts: {
+			// ַҵе
+			mid = (start + end) / 2;
+			std::nth_element(&primitiveInfo[start], &primitiveInfo[mid],
+				&primitiveInfo[end - 1] + 1,
+				[dim](const BVHPrimitiveInfo& a,
+					const BVHPrimitiveInfo& b) {
+				return a.centroid[dim] < b.centroid[dim];
+			});
+			break;
+		}
+		case SplitMethod::SAH:
+		default: {
+			// SAH
+			if (nPrimitives <= 2) {
+				// ͼԪ٣˻Ϊַ
+				mid = (start + end) / 2;
+				std::nth_element(&primitiveInfo[start], &primitiveInfo[mid],
+					&primitiveInfo[end - 1] + 1,
+					[dim](const BVHPrimitiveInfo& a,
+						const BVHPrimitiveInfo& b) {
+					return a.centroid[dim] <
+						b.centroid[dim];
+				});
 			}
 			else {
-				// ѡָ
-				switch (splitMethod) {
-				case SplitMethod::Middle: {
-					// е㷨ҵĵΧ (centroidBounds)  dim ϵĿռе pmid
-					// ͵
-					float pmid =
-						(centroidBounds.pMin[dim] + centroidBounds.pMax[dim]) / 2;
-					BVHPrimitiveInfo* midPtr = std::partition(
+				// ͰͼԪλ÷Ͱ
+				BucketInfo buckets[nBuckets];
+				computeBuckets(primitiveInfo, start, end, nThreads, centroidBounds, dim, buckets);
+
+				// ۣ1 ǱڲڵĴۣ
+				//count0 * b0.SurfaceArea() ӽڵ󽻵ۣͱ
+				float cost[nBuckets - 1];
+				for (int i = 0; i < nBuckets - 1; ++i) {
+					Bounds3f b0, b1;
+					int count0 = 0, count1 = 0;
+					for (int j = 0; j <= i; ++j) {
+						b0 = Union(b0, buckets[j].bounds);
+						count0 += buckets[j].count;
+					}
+					for (int j = i + 1; j < nBuckets; ++j) {
+						b1 = Union(b1, buckets[j].bounds);
+						count1 += buckets[j].count;
+					}
+					cost[i] = 1 +
+						(count0 * b0.SurfaceArea() +
+							count1 * b1.SurfaceArea()) /
+						bounds.SurfaceArea();
+				}
+
+				// ҵС۶Ӧѷָ
+				float minCost = cost[0];
+				int minCostSplitBucket = 0;
+				for (int i = 1; i < nBuckets - 1; ++i) {
+					if (cost[i] < minCost) {
+						minCost = cost[i];
+						minCostSplitBucket = i;
+					}
+				}
+
+				// ִзָҳָ
+				float leafCost = nPrimitives;
+				if (nPrimitives > maxPrimsInNode || minCost < leafCost) {
+					BVHPrimitiveInfo* pmid = std::partition(
 						&primitiveInfo[start], &primitiveInfo[end - 1] + 1,
-						[dim, pmid](const BVHPrimitiveInfo& pi) {
-						return pi.centroid[dim] < pmid;
+						[=](const BVHPrimitiveInfo& pi) {
+						int b = nBuckets *
+							centroidBounds.Offset(pi.centroid)[dim];
+						if (b == nBuckets) b = nBuckets - 1;
+						return b <= minCostSplitBucket;
 					});
-					mid = midPtr - &primitiveInfo[0];
-					// ͼԪеͬ-ַ
-					if (mid != start && mid != end) break;
+					mid = pmid - &primitiveInfo[0];
 				}
-				case SplitMethod::EqualCounts: {
-					// ַҵе
-					mid = (start + end) / 2;
-					std::nth_element(&primitiveInfo[start], &primitiveInfo[mid],
-						&primitiveInfo[end - 1] + 1,
-						[dim](const BVHPrimitiveInfo& a,
-							const BVHPrimitiveInfo& b) {
-						return a.centroid[dim] < b.centroid[dim];
-					});
-					break;
+				else {
+					// SAHжָ
+					return createLeaf(node, primitiveInfo, start, end, bounds, orderedPrims);
 				}
-				case SplitMethod::SAH:
-				default: {
-					// SAH
-					if (nPrimitives <= 2) {
-						// ͼԪ٣˻Ϊַ
-						mid = (start + end) / 2;
-						std::nth_element(&primitiveInfo[start], &primitiveInfo[mid],
-							&primitiveInfo[end - 1] + 1,
-							[dim](const BVHPrimitiveInfo& a,
-								const BVHPrimitiveInfo& b) {
-							return a.centroid[dim] <
-								b.centroid[dim];
-						});
-					}
-					else {
-						// Ͱ
-						constexpr int nBuckets = 12;
-						BucketInfo buckets[nBuckets];
-
-						// ͼԪλ÷Ͱ
-						for (int i = start; i < end; ++i) {
-							int b = nBuckets *
-								centroidBounds.Offset(
-									primitiveInfo[i].centroid)[dim];
-							if (b == nBuckets) b = nBuckets - 1;
-							buckets[b].count++;
-							buckets[b].bounds =
-								Union(buckets[b].bounds, primitiveInfo[i].bounds);
-						}
+			}
+			break;
+		}
 
-						// ۣ1 ǱڲڵĴۣ
-						//count0 * b0.SurfaceArea() ӽڵ󽻵ۣͱ
-						float cost[nBuckets - 1];
-						for (int i = 0; i < nBuckets - 1; ++i) {
-							Bounds3f b0, b1;
-							int count0 = 0, count1 = 0;
-							for (int j = 0; j <= i; ++j) {
-								b0 = Union(b0, buckets[j].bounds);
-								count0 += buckets[j].count;
-							}
-							for (int j = i + 1; j < nBuckets; ++j) {
-								b1 = Union(b1, buckets[j].bounds);
-								count1 += buckets[j].count;
-							}
-							cost[i] = 1 +
-								(count0 * b0.SurfaceArea() +
-									count1 * b1.SurfaceArea()) /
-								bounds.SurfaceArea();
-						}
+		}
+		//ݹ鴦벿/Ұ벿֣뻥صϴΪ񹹽
+		BVHBuildNode* children[2];
+		if (depth < maxSpawnDepth && nPrimitives >= kParallelBuildMinPrims) {
+			MemoryArena& rightArena = newBuildArena();
+#pragma omp parallel sections num_threads(2)
+			{
+#pragma omp section
+				children[0] = recursiveBuild(arena, primitiveInfo, start, mid,
+					totalNodes, orderedPrims, depth + 1);
+#pragma omp section
+				children[1] = recursiveBuild(rightArena, primitiveInfo, mid, end,
+					totalNodes, orderedPrims, depth + 1);
+			}
+		}
+		else {
+			children[0] = recursiveBuild(arena, primitiveInfo, start, mid,
+				totalNodes, orderedPrims, depth + 1);
+			children[1] = recursiveBuild(arena, primitiveInfo, mid, end,
+				totalNodes, orderedPrims, depth + 1);
+		}
+		node->InitInterior(dim, children[0], children[1]);
+		return node;
+	}
+	// HLBVHͼԪĵMorton룬ÿ10λ
+	struct MortonPrimitive {
+		int primitiveIndex;
+		uint32_t mortonCode;
+	};
 
-						// ҵС۶Ӧѷָ
-						float minCost = cost[0];
-						int minCostSplitBucket = 0;
-						for (int i = 1; i < nBuckets - 1; ++i) {
-							if (cost[i] < minCost) {
-								minCost = cost[i];
-								minCostSplitBucket = i;
-							}
-						}
+	// ƬtreeletMorton12λͬһͼԪ
+	struct LBVHTreelet {
+		int startIndex, nPrimitives;
+		BVHBuildNode* buildNodes;
+	};
 
-						// ִзָҳָ
-						float leafCost = nPrimitives;
-						if (nPrimitives > maxPrimsInNode || minCost < leafCost) {
-							BVHPrimitiveInfo* pmid = std::partition(
-								&primitiveInfo[start], &primitiveInfo[end - 1] + 1,
-								[=](const BVHPrimitiveInfo& pi) {
-								int b = nBuckets *
-									centroidBounds.Offset(pi.centroid)[dim];
-								if (b == nBuckets) b = nBuckets - 1;
-								return b <= minCostSplitBucket;
-							});
-							mid = pmid - &primitiveInfo[0];
-						}
-						else {
-							// SAHжָ
-							int firstPrimOffset = orderedPrims.size();
-							for (int i = start; i < end; ++i) {
-								int primNum = primitiveInfo[i].primitiveNumber;
-								orderedPrims.push_back(primitives[primNum]);
-							}
-							node->InitLeaf(firstPrimOffset, nPrimitives, bounds);
-							return node;
+	// 10λÿһλ֮0
+	inline uint32_t LeftShift3(uint32_t x) {
+		if (x == (1 << 10)) --x;
+		x = (x | (x << 16)) & 0b00000011000000000000000011111111;
+		x = (x | (x << 8)) & 0b00000011000000001111000000001111;
+		x = (x | (x << 4)) & 0b00000011000011000011000011000011;
+		x = (x | (x << 2)) & 0b00001001001001001001001001001001;
+		return x;
+	}
+
+	inline uint32_t EncodeMorton3(const Vector3f& v) {
+		return (LeftShift3(v.z) << 2) | (LeftShift3(v.y) << 1) | LeftShift3(v.x);
+	}
+
+	// 30λMorton룬ÿ6λÿ߳ͳԼһεͰ
+	// Ͱ̣߳˳ǰ׺ͺԷɢд룬ȶҽ߳޹
+	static void RadixSort(std::vector<MortonPrimitive>* v, int nThreads) {
+		std::vector<MortonPrimitive> tempVector(v->size());
+		constexpr int bitsPerPass = 6;
+		constexpr int nBits = 30;
+		constexpr int nPasses = nBits / bitsPerPass;
+		constexpr int nBuckets = 1 << bitsPerPass;
+		constexpr int bitMask = (1 << bitsPerPass) - 1;
+		int n = (int)v->size();
+		if (n < kParallelBinMinPrims) nThreads = 1;
+		std::vector<int> bucketCount(nThreads * nBuckets);
+		for (int pass = 0; pass < nPasses; ++pass) {
+			int lowBit = pass * bitsPerPass;
+			// ż˴vtemp˷֮
+			std::vector<MortonPrimitive>& in = (pass & 1) ? tempVector : *v;
+			std::vector<MortonPrimitive>& out = (pass & 1) ? *v : tempVector;
+			std::fill(bucketCount.begin(), bucketCount.end(), 0);
+#pragma omp parallel num_threads(nThreads)
+			{
+				// ʱܸnThreadṣ߳OMP_THREAD_LIMIT̬Ƕף
+				// ʵʵ֣߳ȱٵ̸߳Ƕβᱻͳд
+				int t = omp_get_thread_num();
+				int nTeam = omp_get_num_threads();
+				int begin = (int)((int64_t)n * t / nTeam);
+				int end = (int)((int64_t)n * (t + 1) / nTeam);
+				int* count = &bucketCount[t * nBuckets];
+				for (int i = begin; i < end; ++i)
+					++count[(in[i].mortonCode >> lowBit) & bitMask];
+#pragma omp barrier
+#pragma omp single
+				{
+					// ÿͰ̣߳ʼдλ
+					int offset = 0;
+					for (int b = 0; b < nBuckets; ++b)
+						for (int th = 0; th < nTeam; ++th) {
+							int c = bucketCount[th * nBuckets + b];
+							bucketCount[th * nBuckets + b] = offset;
+							offset += c;
 						}
-					}
-					break;
 				}
+				for (int i = begin; i < end; ++i) {
+					int bucket = (in[i].mortonCode >> lowBit) & bitMask;
+					out[count[bucket]++] = in[i];
+				}
+			}
+		}
+		// ΪʱtempVector
+		if (nPasses & 1) std::swap(*v, tempVector);
+	}
+
+	BVHBuildNode* BVHAccel::HLBVHBuild(MemoryArena& arena,
+		const std::vector<BVHPrimitiveInfo>& primitiveInfo,
+		std::atomic<int>* totalNodes,
+		std::vector<PrimitiveRef>& orderedPrims) const {
+		int nPrims = (int)primitiveInfo.size();
+		// ͼԪĵİΧ
+		Bounds3f bounds, centroidBounds;
+		computeBounds(primitiveInfo, 0, nPrims, buildThreads, &bounds, &centroidBounds);
+
+		// Morton룺ĵӳ䵽[0, 1024)
+		std::vector<MortonPrimitive> mortonPrims(nPrims);
+#pragma omp parallel for schedule(static) num_threads(buildThreads)
+		for (int i = 0; i < nPrims; ++i) {
+			constexpr int mortonBits = 10;
+			constexpr int mortonScale = 1 << mortonBits;
+			mortonPrims[i].primitiveIndex = (int)primitiveInfo[i].primitiveNumber;
+			Vector3f centroidOffset = centroidBounds.Offset(primitiveInfo[i].centroid);
+			mortonPrims[i].mortonCode = EncodeMorton3(centroidOffset * mortonScale);
+		}
+		RadixSort(&mortonPrims, buildThreads);
+
+		// Morton12λƬ
+		std::vector<LBVHTreelet> treeletsToBuild;
+		for (int start = 0, end = 1; end <= nPrims; ++end) {
+			uint32_t mask = 0b00111111111111000000000000000000;
+			if (end == nPrims ||
+				((mortonPrims[start].mortonCode & mask) !=
+				(mortonPrims[end].mortonCode & mask))) {
+				// Ƭ2n-1ڵ㣬һԷ
+				int nPrimitives = end - start;
+				int maxBVHNodes = 2 * nPrimitives - 1;
+				BVHBuildNode* treeletNodes = arena.Alloc<BVHBuildNode>(maxBVHNodes, false);
+				treeletsToBuild.push_back({ start, nPrimitives, treeletNodes });
+				start = end;
+			}
+		}
+
+		// йƬҶӵͼԪλþMortonеλã̵߳޹
+		int nTreelets = (int)treeletsToBuild.size();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(buildThreads)
+		for (int i = 0; i < nTreelets; ++i) {
+			int nodesCreated = 0;
+			const int firstBitIndex = 29 - 12;
+			LBVHTreelet& tr = treeletsToBuild[i];
+			BVHBuildNode* buildNodes = tr.buildNodes;
+			tr.buildNodes = emitLBVH(buildNodes, primitiveInfo, &mortonPrims[0],
+				tr.startIndex, tr.nPrimitives, &nodesCreated, orderedPrims, firstBitIndex);
+			*totalNodes += nodesCreated;
+		}
+
+		// SAHƬӳ
+		std::vector<BVHBuildNode*> finishedTreelets;
+		finishedTreelets.reserve(treeletsToBuild.size());
+		for (LBVHTreelet& treelet : treeletsToBuild)
+			finishedTreelets.push_back(treelet.buildNodes);
+		return buildUpperSAH(arena, finishedTreelets, 0, (int)finishedTreelets.size(), totalNodes);
+	}
+
+	// ƬڲMortonλ֣bitIndexλΪ0Ϊ1
+	BVHBuildNode* BVHAccel::emitLBVH(BVHBuildNode*& buildNodes,
+		const std::vector<BVHPrimitiveInfo>& primitiveInfo,
+		const MortonPrimitive* mortonPrims, int start, int nPrimitives, int* totalNodes,
+		std::vector<PrimitiveRef>& orderedPrims, int bitIndex) const {
+		if (bitIndex == -1 || nPrimitives < maxPrimsInNode) {
+			// Ҷӽڵ
+			(*totalNodes)++;
+			BVHBuildNode* node = buildNodes++;
+			Bounds3f bounds;
+			for (int i = 0; i < nPrimitives; ++i) {
+				int primitiveIndex = mortonPrims[start + i].primitiveIndex;
+				orderedPrims[start + i] = primitiveRefs[primitiveIndex];
+				bounds = Union(bounds, primitiveInfo[primitiveIndex].bounds);
+			}
+			node->InitLeaf(start, nPrimitives, bounds);
+			return node;
+		}
+		else {
+			int mask = 1 << bitIndex;
+			// βͼԪڸλͬ˵ζͬһλ
+			if ((mortonPrims[start].mortonCode & mask) ==
+				(mortonPrims[start + nPrimitives - 1].mortonCode & mask))
+				return emitLBVH(buildNodes, primitiveInfo, mortonPrims, start, nPrimitives,
+					totalNodes, orderedPrims, bitIndex - 1);
+
+			// ֲҸλ01λ
+			int searchStart = start, searchEnd = start + nPrimitives - 1;
+			while (searchStart + 1 != searchEnd) {
+				int mid = (searchStart + searchEnd) / 2;
+				if ((mortonPrims[searchStart].mortonCode & mask) ==
+					(mortonPrims[mid].mortonCode & mask))
+					searchStart = mid;
+				else
+					searchEnd = mid;
+			}
+			int splitOffset = searchEnd - start;
+
+			// ڲڵ
+			(*totalNodes)++;
+			BVHBuildNode* node = buildNodes++;
+			BVHBuildNode* lbvh[2] = {
+				emitLBVH(buildNodes, primitiveInfo, mortonPrims, start, splitOffset,
+					totalNodes, orderedPrims, bitIndex - 1),
+				emitLBVH(buildNodes, primitiveInfo, mortonPrims, start + splitOffset,
+					nPrimitives - splitOffset, totalNodes, orderedPrims, bitIndex - 1) };
+			int axis = bitIndex % 3;
+			node->InitInterior(axis, lbvh[0], lbvh[1]);
+			return node;
+		}
+	}
+
+	// ϲ㣺ƬڵΪλSAHָ
+	BVHBuildNode* BVHAccel::buildUpperSAH(MemoryArena& arena,
+		std::vector<BVHBuildNode*>& treeletRoots,
+		int start, int end, std::atomic<int>* totalNodes) const {
+		int nNodes = end - start;
+		if (nNodes == 1) return treeletRoots[start];
+		(*totalNodes)++;
+		BVHBuildNode* node = arena.Alloc<BVHBuildNode>();
+
+		Bounds3f bounds;
+		for (int i = start; i < end; ++i)
+			bounds = Union(bounds, treeletRoots[i]->bounds);
+
+		Bounds3f centroidBounds;
+		for (int i = start; i < end; ++i) {
+			Point3f centroid =
+				(treeletRoots[i]->bounds.pMin + treeletRoots[i]->bounds.pMax) * 0.5f;
+			centroidBounds = Union(centroidBounds, centroid);
+		}
+		int dim = centroidBounds.MaximumExtent();
+		auto bucketIndex = [&](const BVHBuildNode* n) {
+			float centroid = (n->bounds.pMin[dim] + n->bounds.pMax[dim]) * 0.5f;
+			int b = nBuckets * ((centroid - centroidBounds.pMin[dim]) /
+				(centroidBounds.pMax[dim] - centroidBounds.pMin[dim]));
+			return b == nBuckets ? nBuckets - 1 : b;
+		};
+
+		int mid = (start + end) / 2;
+		if (centroidBounds.pMax[dim] != centroidBounds.pMin[dim]) {
+			BucketInfo buckets[nBuckets];
+			for (int i = start; i < end; ++i) {
+				int b = bucketIndex(treeletRoots[i]);
+				buckets[b].count++;
+				buckets[b].bounds = Union(buckets[b].bounds, treeletRoots[i]->bounds);
+			}
+
+			float cost[nBuckets - 1];
+			for (int i = 0; i < nBuckets - 1; ++i) {
+				Bounds3f b0, b1;
+				int count0 = 0, count1 = 0;
+				for (int j = 0; j <= i; ++j) {
+					b0 = Union(b0, buckets[j].bounds);
+					count0 += buckets[j].count;
+				}
+				for (int j = i + 1; j < nBuckets; ++j) {
+					b1 = Union(b1, buckets[j].bounds);
+					count1 += buckets[j].count;
+				}
+				cost[i] = .125f +
+					(count0 * b0.SurfaceArea() + count1 * b1.SurfaceArea()) /
+					bounds.SurfaceArea();
+			}
 
+			float minCost = cost[0];
+			int minCostSplitBucket = 0;
+			for (int i = 1; i < nBuckets - 1; ++i) {
+				if (cost[i] < minCost) {
+					minCost = cost[i];
+					minCostSplitBucket = i;
 				}
-				//ݹ鴦벿/Ұ벿
-				node->InitInterior(dim,
-					recursiveBuild(primitiveInfo, start, mid,
-						totalNodes, orderedPrims),
-					recursiveBuild(primitiveInfo, mid, end,
-						totalNodes, orderedPrims));
 			}
+
+			BVHBuildNode** pmid = std::partition(
+				&treeletRoots[start], &treeletRoots[end - 1] + 1,
+				[&](const BVHBuildNode* n) { return bucketIndex(n) <= minCostSplitBucket; });
+			mid = pmid - &treeletRoots[0];
 		}
+		// Ƭͬһʱ
+		if (mid == start || mid == end) mid = (start + end) / 2;
+
+		node->InitInterior(dim,
+			buildUpperSAH(arena, treeletRoots, start, mid, totalNodes),
+			buildUpperSAH(arena, treeletRoots, mid, end, totalNodes));
 		return node;
 	}
 	//ȣıƽ
@@ -282,25 +730,562 @@ namespace PBR {
 		return myOffset;
 	}
 
+	// ҶеͼԪBVH˳ΪSoAο飬ÿҶռceil(n/W)Ŀ
+	template <int W>
+	TriangleBlock<W>* BVHAccel::buildTriangleBlocks(int totalNodes) {
+		int nBlocks = 0;
+		for (int i = 0; i < totalNodes; ++i)
+			if (nodes[i].nPrimitives > 0)
+				nBlocks += (nodes[i].nPrimitives + W - 1) / W;
+		TriangleBlock<W>* blocks = AllocAligned<TriangleBlock<W>>(nBlocks);
+		int blockOffset = 0;
+		for (int i = 0; i < totalNodes; ++i) {
+			LinearBVHNode& node = nodes[i];
+			if (node.nPrimitives == 0) continue;
+			int firstRef = node.primitivesOffset;
+			node.primitivesOffset = blockOffset;
+			for (int j = 0; j < node.nPrimitives; j += W) {
+				TriangleBlock<W>& block = blocks[blockOffset++];
+				memset(&block, 0, sizeof(block));
+				for (int lane = 0; lane < W; ++lane) {
+					if (j + lane >= node.nPrimitives) {
+						block.refIndex[lane] = -1;
+						continue;
+					}
+					int refIndex = firstRef + j + lane;
+					block.refIndex[lane] = refIndex;
+					const PrimitiveRef& ref = primitiveRefs[refIndex];
+					if (ref.triIndex < 0) continue;
+					Point3f p[3];
+					meshPrimitives[ref.primIndex]->TriangleVertices(ref.triIndex, p);
+					for (int v = 0; v < 3; ++v)
+						for (int a = 0; a < 3; ++a)
+							block.p[v][a][lane] = p[v][a];
+					block.triMask |= 1 << lane;
+				}
+			}
+		}
+		treeBytes += nBlocks * sizeof(TriangleBlock<W>);
+		return blocks;
+	}
+
+	// λͨͳ
+	static inline int countBits(int mask) {
+		int n = 0;
+		for (; mask; mask &= mask - 1) ++n;
+		return n;
+	}
+
+	// Ҷ󽻣οʱSIMD·ͼԪ󽻣
+	// εĽ㶼ȼdeferred
+	bool BVHAccel::intersectLeaf(int offset, int nPrimitives, const Ray& ray,
+		const TriangleBlockRay& blockRay, SurfaceInteraction* isect,
+		DeferredHit* deferred) const {
+		if (triBlocks4)
+			return intersectBlocks(triBlocks4, offset, nPrimitives, ray, blockRay, isect, deferred);
+		if (triBlocks8)
+			return intersectBlocks(triBlocks8, offset, nPrimitives, ray, blockRay, isect, deferred);
+		bool hit = false;
+		for (int i = 0; i < nPrimitives; ++i) {
+			const PrimitiveRef& ref = primitiveRefs[offset + i];
+			if (ref.triIndex >= 0) {
+				// Σֻt꣬ĽḲ
+				float t, b[3];
+				if (meshPrimitives[ref.primIndex]->TriangleHit(ref.triIndex, ray, &t, b)) {
+					ray.tMax = t;
+					deferred->refIndex = offset + i;
+					for (int j = 0; j < 3; ++j) deferred->b[j] = b[j];
+					hit = true;
+				}
+			}
+			else if (primitives[ref.primIndex]->Intersect(ray, isect)) {
+				hit = true;
+				deferred->refIndex = -1;
+			}
+		}
+		return hit;
+	}
+
+	bool BVHAccel::intersectPLeaf(int offset, int nPrimitives, const Ray& ray,
+		const TriangleBlockRay& blockRay) const {
+		if (triBlocks4)
+			return intersectPBlocks(triBlocks4, offset, nPrimitives, ray, blockRay);
+		if (triBlocks8)
+			return intersectPBlocks(triBlocks8, offset, nPrimitives, ray, blockRay);
+		for (int i = 0; i < nPrimitives; ++i)
+			if (intersectPRef(primitiveRefs[offset + i], ray))
+				return true;
+		return false;
+	}
+
+	// ο󽻣SIMDֻ(t, )deferredУ
+	// finishDeferredHitһSurfaceInteraction
+	template <int W>
+	bool BVHAccel::intersectBlocks(const TriangleBlock<W>* blocks, int offset, int nPrimitives,
+		const Ray& ray, const TriangleBlockRay& blockRay, SurfaceInteraction* isect,
+		DeferredHit* deferred) const {
+		bool hit = false;
+		int nBlocks = (nPrimitives + W - 1) / W;
+		for (int k = 0; k < nBlocks; ++k) {
+			const TriangleBlock<W>& block = blocks[offset + k];
+			alignas(32) float tHit[W];
+			alignas(32) float b[3][W];
+			int fallbackMask;
+			float tMaxTested = ray.tMax;
+			int hitMask = IntersectTriangleBlock(block, blockRay, tMaxTested, tHit, b, &fallbackMask);
+			STAT_ADD(TriangleTests, countBits(block.triMask & ~fallbackMask));
+			STAT_ADD(TriangleHits, countBits(hitMask & block.triMask & ~fallbackMask));
+			// ͨ˳ʱĽһ
+			for (int lane = 0; lane < W; ++lane) {
+				int refIndex = block.refIndex[lane];
+				if (refIndex < 0) break;
+				const PrimitiveRef& ref = primitiveRefs[refIndex];
+				if (!(block.triMask & (1 << lane))) {
+					// ͨͼԪֱӹ콻㣬֮ǰ¼ν㱻
+					if (intersectRef(ref, ray, isect)) {
+						hit = true;
+						deferred->refIndex = -1;
+					}
+				}
+				else if (fallbackMask & (1 << lane)) {
+					// ߺΪ0ô˫ı
+					float t, bl[3];
+					if (meshPrimitives[ref.primIndex]->TriangleHit(ref.triIndex, ray, &t, bl)) {
+						ray.tMax = t;
+						deferred->refIndex = refIndex;
+						for (int i = 0; i < 3; ++i) deferred->b[i] = bl[i];
+						hit = true;
+					}
+				}
+				else if ((hitMask & (1 << lane)) &&
+					(ray.tMax == tMaxTested || tHit[lane] <= ray.tMax)) {
+					ray.tMax = tHit[lane];
+					deferred->refIndex = refIndex;
+					for (int i = 0; i < 3; ++i) deferred->b[i] = b[i][lane];
+					hit = true;
+				}
+			}
+		}
+		return hit;
+	}
+
+	template <int W>
+	bool BVHAccel::intersectPBlocks(const TriangleBlock<W>* blocks, int offset, int nPrimitives,
+		const Ray& ray, const TriangleBlockRay& blockRay) const {
+		int nBlocks = (nPrimitives + W - 1) / W;
+		for (int k = 0; k < nBlocks; ++k) {
+			const TriangleBlock<W>& block = blocks[offset + k];
+			alignas(32) float tHit[W];
+			alignas(32) float b[3][W];
+			int fallbackMask;
+			int hitMask = IntersectTriangleBlock(block, blockRay, ray.tMax, tHit, b, &fallbackMask);
+			STAT_ADD(TriangleTests, countBits(block.triMask & ~fallbackMask));
+			if (hitMask & block.triMask & ~fallbackMask) return true;
+			for (int lane = 0; lane < W; ++lane) {
+				int refIndex = block.refIndex[lane];
+				if (refIndex < 0) break;
+				const PrimitiveRef& ref = primitiveRefs[refIndex];
+				if (!(block.triMask & (1 << lane))) {
+					if (intersectPRef(ref, ray)) return true;
+				}
+				else if (fallbackMask & (1 << lane)) {
+					if (meshPrimitives[ref.primIndex]->IntersectPTriangle(ref.triIndex, ray))
+						return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	void BVHAccel::finishDeferredHit(const DeferredHit& deferred, const Ray& ray,
+		SurfaceInteraction* isect) const {
+		const PrimitiveRef& ref = primitiveRefs[deferred.refIndex];
+		meshPrimitives[ref.primIndex]->TriangleInteraction(ref.triIndex, ray, deferred.b, isect);
+	}
+
+	// BVHڵ㣺ӽڵΧаSoAִ洢
+	// bounds[0/1][][ӽڵ] ֱС/ֵһSIMDָNӽڵ
+	template <int N>
+	struct alignas(64) WideBVHNode {
+		float bounds[2][3][N];
+		// ڲӽڵ㣺ڵ±ꣻҶӣͼԪƫƣղۣ-1
+		int child[N];
+		// ҶеͼԪڲӽڵΪ0
+		uint16_t nPrimitives[N];
+	};
+
+	// Ѷ۵ΪNչڲӽڵ㣬ֱNӽڵ
+	template <int N>
+	static int gatherWideChildren(const LinearBVHNode* nodes, int nodeIndex, int children[N]) {
+		int nChildren = 0;
+		const LinearBVHNode* node = &nodes[nodeIndex];
+		if (node->nPrimitives > 0)
+			children[nChildren++] = nodeIndex;
+		else {
+			children[nChildren++] = nodeIndex + 1;
+			children[nChildren++] = node->secondChildOffset;
+		}
+		while (nChildren < N) {
+			int best = -1;
+			float bestArea = -1;
+			for (int i = 0; i < nChildren; ++i) {
+				const LinearBVHNode* c = &nodes[children[i]];
+				if (c->nPrimitives == 0 && c->bounds.SurfaceArea() > bestArea) {
+					bestArea = c->bounds.SurfaceArea();
+					best = i;
+				}
+			}
+			if (best < 0) break;
+			int expand = children[best];
+			children[best] = expand + 1;
+			children[nChildren++] = nodes[expand].secondChildOffset;
+		}
+		return nChildren;
+	}
+
+	// һ飺ͳƶڵԱһԷڴ
+	template <int N>
+	static int countWideNodes(const LinearBVHNode* nodes, int nodeIndex) {
+		int children[N];
+		int nChildren = gatherWideChildren<N>(nodes, nodeIndex, children);
+		int count = 1;
+		for (int i = 0; i < nChildren; ++i)
+			if (nodes[children[i]].nPrimitives == 0)
+				count += countWideNodes<N>(nodes, children[i]);
+		return count;
+	}
+
+	// ڶ飺˳ڵ㣬ظýڵ±
+	template <int N>
+	static int collapseWide(const LinearBVHNode* nodes, int nodeIndex,
+		WideBVHNode<N>* wideNodes, int* offset) {
+		int children[N];
+		int nChildren = gatherWideChildren<N>(nodes, nodeIndex, children);
+		int myIndex = (*offset)++;
+		WideBVHNode<N>& wn = wideNodes[myIndex];
+		// ȰвλΪգΧȡκι߶
+		for (int i = 0; i < N; ++i) {
+			for (int a = 0; a < 3; ++a) {
+				wn.bounds[0][a][i] = Infinity;
+				wn.bounds[1][a][i] = -Infinity;
+			}
+			wn.child[i] = -1;
+			wn.nPrimitives[i] = 0;
+		}
+		for (int i = 0; i < nChildren; ++i) {
+			const LinearBVHNode* c = &nodes[children[i]];
+			for (int a = 0; a < 3; ++a) {
+				wn.bounds[0][a][i] = c->bounds.pMin[a];
+				wn.bounds[1][a][i] = c->bounds.pMax[a];
+			}
+			wn.nPrimitives[i] = c->nPrimitives;
+			wn.child[i] = c->nPrimitives > 0 ? c->primitivesOffset :
+				collapseWide<N>(nodes, children[i], wideNodes, offset);
+		}
+		return myIndex;
+	}
+
+	// ڸϵݣ㲥SIMDĴ
+	struct WideRay {
+		WideRay(const Ray& ray) {
+			Vector3f invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+			for (int a = 0; a < 3; ++a) {
+				o[a] = ray.o[a];
+				inv[a] = invDir[a];
+				dirIsNeg[a] = invDir[a] < 0;
+			}
+		}
+		float o[3], inv[3];
+		int dirIsNeg[3];
+	};
+
+	// Bounds3::IntersectPͬslabԣԶ˳(1+2*gamma(3))֤ء
+	// ػӽڵλ룬tNearΪӽڵĽ롣
+	// _mm_max_ps/_mm_min_psڲΪNaNʱصڶ0*infNaNȻ
+	// bounds[m][a]֮stridefloat
+	static inline int hitMask4(const float* bounds, int stride, const WideRay& r,
+		float tMax, float* tNear) {
+		__m128 tEnter = _mm_setzero_ps();
+		__m128 tExit = _mm_set1_ps(tMax);
+		for (int a = 0; a < 3; ++a) {
+			__m128 o = _mm_set1_ps(r.o[a]);
+			__m128 inv = _mm_set1_ps(r.inv[a]);
+			const float* nearRow = bounds + (r.dirIsNeg[a] * 3 + a) * stride;
+			const float* farRow = bounds + ((1 - r.dirIsNeg[a]) * 3 + a) * stride;
+			__m128 tn = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearRow), o), inv);
+			__m128 tf = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(farRow), o), inv);
+			tEnter = _mm_max_ps(tn, tEnter);
+			tExit = _mm_min_ps(tf, tExit);
+		}
+		tExit = _mm_mul_ps(tExit, _mm_set1_ps(1 + 2 * gamma(3)));
+		_mm_storeu_ps(tNear, tEnter);
+		return _mm_movemask_ps(_mm_cmple_ps(tEnter, tExit));
+	}
+
+	static inline int hitMask(const WideBVHNode<4>& node, const WideRay& r,
+		float tMax, float* tNear) {
+		return hitMask4(&node.bounds[0][0][0], 4, r, tMax, tNear);
+	}
+
+	static inline int hitMask(const WideBVHNode<8>& node, const WideRay& r,
+		float tMax, float* tNear) {
+#if defined(__AVX__)
+		__m256 tEnter = _mm256_setzero_ps();
+		__m256 tExit = _mm256_set1_ps(tMax);
+		for (int a = 0; a < 3; ++a) {
+			__m256 o = _mm256_set1_ps(r.o[a]);
+			__m256 inv = _mm256_set1_ps(r.inv[a]);
+			__m256 tn = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[r.dirIsNeg[a]][a]), o), inv);
+			__m256 tf = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[1 - r.dirIsNeg[a]][a]), o), inv);
+			tEnter = _mm256_max_ps(tn, tEnter);
+			tExit = _mm256_min_ps(tf, tExit);
+		}
+		tExit = _mm256_mul_ps(tExit, _mm256_set1_ps(1 + 2 * gamma(3)));
+		_mm256_storeu_ps(tNear, tEnter);
+		return _mm256_movemask_ps(_mm256_cmp_ps(tEnter, tExit, _CMP_LE_OQ));
+#else
+		// δAVXʱSSE
+		const float* b = &node.bounds[0][0][0];
+		return hitMask4(b, 8, r, tMax, tNear) | (hitMask4(b + 4, 8, r, tMax, tNear + 4) << 4);
+#endif
+	}
+
+	template <int N>
+	bool BVHAccel::intersectWide(const WideBVHNode<N>* wideNodes, const Ray& ray,
+		SurfaceInteraction* isect) const {
+		bool hit = false;
+		WideRay r(ray);
+		TriangleBlockRay blockRay;
+		if (blockWidth > 0) blockRay = TriangleBlockRay(ray);
+		DeferredHit deferred;
+		// ջͬʱ¼룬ʱѱȵǰԶֱ
+		struct StackEntry {
+			int node;
+			float tNear;
+		};
+		StackEntry nodesToVisit[64 * (N - 1)];
+		int toVisitOffset = 0;
+		nodesToVisit[toVisitOffset++] = { 0, 0.f };
+		int nodesVisited = 0;
+		while (toVisitOffset > 0) {
+			StackEntry entry = nodesToVisit[--toVisitOffset];
+			if (entry.tNear > ray.tMax) continue;
+			const WideBVHNode<N>& node = wideNodes[entry.node];
+			++nodesVisited;
+			alignas(32) float tNear[N];
+			int mask = hitMask(node, r, ray.tMax, tNear);
+
+			// еӽڵ㰴ɽԶ򣨲NС
+			int order[N];
+			int nHit = 0;
+			for (int i = 0; i < N; ++i) {
+				if (!(mask & (1 << i)) || node.child[i] < 0) continue;
+				int j = nHit++;
+				while (j > 0 && tNear[order[j - 1]] > tNear[i]) {
+					order[j] = order[j - 1];
+					--j;
+				}
+				order[j] = i;
+			}
+			// ڲӽڵԶջȵ
+			for (int k = nHit - 1; k >= 0; --k) {
+				int i = order[k];
+				if (node.nPrimitives[i] == 0)
+					nodesToVisit[toVisitOffset++] = { node.child[i], tNear[i] };
+			}
+			// ҶɽԶֱ󽻣ray.tMax֮
+			for (int k = 0; k < nHit; ++k) {
+				int i = order[k];
+				if (node.nPrimitives[i] == 0 || tNear[i] > ray.tMax) continue;
+				if (intersectLeaf(node.child[i], node.nPrimitives[i], ray, blockRay,
+					isect, &deferred))
+					hit = true;
+			}
+		}
+		STAT_ADD(BVHNodesVisited, nodesVisited);
+		if (deferred.refIndex >= 0) finishDeferredHit(deferred, ray, isect);
+		return hit;
+	}
+
+	template <int N>
+	bool BVHAccel::intersectPWide(const WideBVHNode<N>* wideNodes, const Ray& ray) const {
+		WideRay r(ray);
+		TriangleBlockRay blockRay;
+		if (blockWidth > 0) blockRay = TriangleBlockRay(ray);
+		int nodesToVisit[64 * (N - 1)];
+		int toVisitOffset = 0;
+		nodesToVisit[toVisitOffset++] = 0;
+		int nodesVisited = 0;
+		while (toVisitOffset > 0) {
+			const WideBVHNode<N>& node = wideNodes[nodesToVisit[--toVisitOffset]];
+			++nodesVisited;
+			alignas(32) float tNear[N];
+			int mask = hitMask(node, r, ray.tMax, tNear);
+			// Ӱֻ⽻㣬
+			for (int i = 0; i < N; ++i) {
+				if (!(mask & (1 << i)) || node.child[i] < 0) continue;
+				if (node.nPrimitives[i] == 0)
+					nodesToVisit[toVisitOffset++] = node.child[i];
+				else if (intersectPLeaf(node.child[i], node.nPrimitives[i], ray, blockRay)) {
+					STAT_ADD(BVHNodesVisited, nodesVisited);
+					return true;
+				}
+			}
+		}
+		STAT_ADD(BVHNodesVisited, nodesVisited);
+		return false;
+	}
+
+	template <int N>
+	WideBVHNode<N>* BVHAccel::collapseWideTree() const {
+		int nWideNodes = countWideNodes<N>(nodes, 0);
+		WideBVHNode<N>* wideNodes = AllocAligned<WideBVHNode<N>>(nWideNodes);
+		int offset = 0;
+		collapseWide<N>(nodes, 0, wideNodes, &offset);
+		treeBytes += nWideNodes * sizeof(WideBVHNode<N>);
+		return wideNodes;
+	}
+
+	// SAHۣڵռڵıȨ
+	// 뽨ʱһһڲڵһͼԪĴ۶Ϊ1
+	float BVHAccel::SAHCost() const {
+		if (!nodes) return 0;
+		float rootArea = nodes[0].bounds.SurfaceArea();
+		if (rootArea <= 0) return 0;
+		double cost = 0;
+		for (int i = 0; i < totalNodes; ++i)
+			cost += nodes[i].bounds.SurfaceArea() *
+				(nodes[i].nPrimitives > 0 ? nodes[i].nPrimitives : 1);
+		return (float)(cost / rootArea);
+	}
+
+	// ҶӵİΧУοʱͬʱµĶдؿ
+	template <int W>
+	Bounds3f BVHAccel::refitBlocks(TriangleBlock<W>* blocks, int offset, int nPrimitives) {
+		Bounds3f bounds;
+		for (int j = 0; j < (nPrimitives + W - 1) / W; ++j) {
+			TriangleBlock<W>& block = blocks[offset + j];
+			for (int lane = 0; lane < W; ++lane) {
+				if (block.refIndex[lane] < 0) continue;
+				const PrimitiveRef& ref = primitiveRefs[block.refIndex[lane]];
+				if (!(block.triMask & (1 << lane))) {
+					bounds = Union(bounds, refBound(ref));
+					continue;
+				}
+				Point3f p[3];
+				meshPrimitives[ref.primIndex]->TriangleVertices(ref.triIndex, p);
+				for (int v = 0; v < 3; ++v) {
+					for (int a = 0; a < 3; ++a)
+						block.p[v][a][lane] = p[v][a];
+					bounds = Union(bounds, p[v]);
+				}
+			}
+		}
+		return bounds;
+	}
+
+	Bounds3f BVHAccel::refitLeaf(const LinearBVHNode& node) {
+		if (triBlocks4) return refitBlocks(triBlocks4, node.primitivesOffset, node.nPrimitives);
+		if (triBlocks8) return refitBlocks(triBlocks8, node.primitivesOffset, node.nPrimitives);
+		Bounds3f bounds;
+		for (int i = 0; i < node.nPrimitives; ++i)
+			bounds = Union(bounds, refBound(primitiveRefs[node.primitivesOffset + i]));
+		return bounds;
+	}
+
+	// ҶͼԪؼ֡İΧкϲڲڵԵϺϲ
+	void BVHAccel::updateMotionBounds() {
+#pragma omp parallel for schedule(dynamic, 64)
+		for (int i = 0; i < totalNodes; ++i) {
+			const LinearBVHNode& node = nodes[i];
+			if (node.nPrimitives == 0) continue;
+			for (int k = 0; k < 2; ++k) {
+				Bounds3f bounds;
+				for (int j = 0; j < node.nPrimitives; ++j)
+					bounds = Union(bounds, refBound(primitiveRefs[node.primitivesOffset + j], (float)k));
+				motionBounds[2 * i + k] = bounds;
+			}
+		}
+		for (int i = totalNodes - 1; i >= 0; --i) {
+			const LinearBVHNode& node = nodes[i];
+			if (node.nPrimitives > 0) continue;
+			for (int k = 0; k < 2; ++k)
+				motionBounds[2 * i + k] = Union(motionBounds[2 * (i + 1) + k],
+					motionBounds[2 * node.secondChildOffset + k]);
+		}
+	}
+
+	bool BVHAccel::Refit(float maxCostRatio) {
+		if (!nodes) return false;
+		double tStart = omp_get_wtime();
+		// ҶӻأΧ
+#pragma omp parallel for schedule(dynamic, 64)
+		for (int i = 0; i < totalNodes; ++i)
+			if (nodes[i].nPrimitives > 0)
+				nodes[i].bounds = refitLeaf(nodes[i]);
+		// ƽ˳Уӽڵ±Ǵڸڵ㣬
+		// ɨһ鼴ԵϺϲڲڵİΧ
+		for (int i = totalNodes - 1; i >= 0; --i) {
+			LinearBVHNode& node = nodes[i];
+			if (node.nPrimitives == 0)
+				node.bounds = Union(nodes[i + 1].bounds, nodes[node.secondChildOffset].bounds);
+		}
+
+		// ƶʱ½SAH۳ʱmaxCostRatioؽ
+		float cost = SAHCost();
+		if (cost > maxCostRatio * buildCost) {
+			std::cout << std::fixed << std::setprecision(2)
+				<< "BVH refit: SAH cost ratio " << cost / buildCost << " > " << maxCostRatio
+				<< ", rebuilding" << std::endl;
+			build();
+			return true;
+		}
+
+		if (motionBounds) updateMotionBounds();
+		// ɶ۵Χб仯۵
+		if (wideNodes4) {
+			FreeAligned(wideNodes4);
+			wideNodes4 = collapseWideTree<4>();
+		}
+		else if (wideNodes8) {
+			FreeAligned(wideNodes8);
+			wideNodes8 = collapseWideTree<8>();
+		}
+		std::cout << std::fixed << std::setprecision(1)
+			<< "BVH refit: " << totalNodes << " nodes, SAH cost ratio "
+			<< std::setprecision(2) << (buildCost > 0 ? cost / buildCost : 1.f)
+			<< std::setprecision(1) << ", " << 1000 * (omp_get_wtime() - tStart) << " ms" << std::endl;
+		return false;
+	}
+
 	bool BVHAccel::Intersect(const Ray& ray, SurfaceInteraction* isect) const {
 		if (!nodes) return false;
+		if (wideNodes4) return intersectWide(wideNodes4, ray, isect);
+		if (wideNodes8) return intersectWide(wideNodes8, ray, isect);
 		bool hit = false;
+		TriangleBlockRay blockRay;
+		if (blockWidth > 0) blockRay = TriangleBlockRay(ray);
+		DeferredHit deferred;
 		// Ԥȼ
 		Vector3f invDir(1 / ray.d.x, 1 / ray.d.y, 1 / ray.d.z);
 		int dirIsNeg[3] = { invDir.x < 0, invDir.y < 0, invDir.z < 0 };
 		// ջcurrentNodeIndexڴĽڵ
 		int toVisitOffset = 0, currentNodeIndex = 0;
 		int nodesToVisit[64];
+		int nodesVisited = 0;
+		float time = Clamp(ray.time, 0, 1);
 		while (true) {
 			const LinearBVHNode* node = &nodes[currentNodeIndex];
-			// Ƿ˰ΧУ
-			if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
+			++nodesVisited;
+			// Ƿ˰ΧУ˶BVHȡʱֵ̲İΧ
+			if (motionBounds ? motionNodeBounds(currentNodeIndex, time).IntersectP(ray, invDir, dirIsNeg) :
+				node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
 				//Ҷӽڵ
 				if (node->nPrimitives > 0) {
 					// ͼԪͼԪཻ
-					for (int i = 0; i < node->nPrimitives; ++i)
-						if (primitives[node->primitivesOffset + i]->Intersect(ray, isect))
-							hit = true;
+					if (intersectLeaf(node->primitivesOffset, node->nPrimitives, ray,
+						blockRay, isect, &deferred))
+						hit = true;
 					// ջ
 					if (toVisitOffset == 0) break;
 					currentNodeIndex = nodesToVisit[--toVisitOffset];
@@ -324,24 +1309,32 @@ namespace PBR {
 				currentNodeIndex = nodesToVisit[--toVisitOffset];
 			}
 		}
+		STAT_ADD(BVHNodesVisited, nodesVisited);
+		if (deferred.refIndex >= 0) finishDeferredHit(deferred, ray, isect);
 		return hit;
 	}
 
 	bool BVHAccel::IntersectP(const Ray& ray) const {
 		if (!nodes) return false;
+		if (wideNodes4) return intersectPWide(wideNodes4, ray);
+		if (wideNodes8) return intersectPWide(wideNodes8, ray);
+		TriangleBlockRay blockRay;
+		if (blockWidth > 0) blockRay = TriangleBlockRay(ray);
 		Vector3f invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
 		int dirIsNeg[3] = { invDir.x < 0, invDir.y < 0, invDir.z < 0 };
 		int nodesToVisit[64];
 		int toVisitOffset = 0, currentNodeIndex = 0;
+		int nodesVisited = 0;
+		float time = Clamp(ray.time, 0, 1);
 		while (true) {
 			const LinearBVHNode* node = &nodes[currentNodeIndex];
-			if (node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
+			++nodesVisited;
+			if (motionBounds ? motionNodeBounds(currentNodeIndex, time).IntersectP(ray, invDir, dirIsNeg) :
+				node->bounds.IntersectP(ray, invDir, dirIsNeg)) {
 				if (node->nPrimitives > 0) {
-					for (int i = 0; i < node->nPrimitives; ++i) {
-						if (primitives[node->primitivesOffset + i]->IntersectP(
-							ray)) {
-							return true;
-						}
+					if (intersectPLeaf(node->primitivesOffset, node->nPrimitives, ray, blockRay)) {
+						STAT_ADD(BVHNodesVisited, nodesVisited);
+						return true;
 					}
 					if (toVisitOffset == 0) break;
 					currentNodeIndex = nodesToVisit[--toVisitOffset];
@@ -362,6 +1355,7 @@ namespace PBR {
 				currentNodeIndex = nodesToVisit[--toVisitOffset];
 			}
 		}
+		STAT_ADD(BVHNodesVisited, nodesVisited);
 		return false;
 	}
 
@@ -4,38 +4,163 @@
 
 #include "Core\PBR.h"
 #include "Core\primitive.h"
+#include "Core\Memory.h"
+#include "Accelerator\TriangleBlock.h"
 
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
 
 namespace PBR {
 	struct BVHBuildNode;
 	struct BVHPrimitiveInfo;
 	struct LinearBVHNode;
+	struct MortonPrimitive;
+	template <int N> struct WideBVHNode;
+
+	// BVHҶõͼԪͨͼԪtriIndexΪ-1
+	// TriangleMeshPrimitive(, )չÿֻռ8ֽ
+	struct PrimitiveRef {
+		int primIndex;
+		int triIndex;
+	};
 
 	class BVHAccel : public Aggregate {
 	public:
 		enum class SplitMethod { SAH, HLBVH, Middle, EqualCounts };
+		// treeWidthΪ48ʱѶ۵ΪʹSIMD
+		// triangleBlockWidthΪ48ʱҶеδΪSoA鲢SIMD
 		BVHAccel(std::vector<std::shared_ptr<Primitive>> p,
 			int maxPrimsInNode = 1,
-			SplitMethod splitMethod = SplitMethod::SAH);
+			SplitMethod splitMethod = SplitMethod::SAH,
+			int treeWidth = 2,
+			int triangleBlockWidth = 0);
 		Bounds3f WorldBound() const;
 		~BVHAccel();
 		//ȾʱִУ
 		bool Intersect(const Ray& ray, SurfaceInteraction* isect) const;
 		bool IntersectP(const Ray& ray) const;
+		// ͼԪƶ񶥵㣨TriangleMesh::pıãˣ
+		// Եϸ½ڵΧοеĶ㡣SAH۳ʱ
+		// maxCostRatioΪؽtrue
+		bool Refit(float maxCostRatio = 1.5f);
+		// SAHۣԸڵһ
+		float SAHCost() const;
 
 	private:
-		//ݹ齨
-		BVHBuildNode* recursiveBuild(std::vector<BVHPrimitiveInfo>& primitiveInfo,
-			int start, int end, int* totalNodes,
-			std::vector<std::shared_ptr<Primitive>>& orderedPrims);
+		// ɹ캯Refit˻ʱ
+		void build();
+		void freeTree();
+		Bounds3f refitLeaf(const LinearBVHNode& node);
+		template <int W>
+		Bounds3f refitBlocks(TriangleBlock<W>* blocks, int offset, int nPrimitives);
+		//ݹ齨depth ھǷΪ
+		BVHBuildNode* recursiveBuild(MemoryArena& arena,
+			std::vector<BVHPrimitiveInfo>& primitiveInfo, int start, int end, std::atomic<int>* totalNodes,
+			std::vector<PrimitiveRef>& orderedPrims, int depth);
+		BVHBuildNode* createLeaf(BVHBuildNode* node,
+			const std::vector<BVHPrimitiveInfo>& primitiveInfo, int start, int end,
+			const Bounds3f& bounds, std::vector<PrimitiveRef>& orderedPrims);
+		//HLBVHMortonйƬϲSAH
+		BVHBuildNode* HLBVHBuild(MemoryArena& arena,
+			const std::vector<BVHPrimitiveInfo>& primitiveInfo,
+			std::atomic<int>* totalNodes,
+			std::vector<PrimitiveRef>& orderedPrims) const;
+		BVHBuildNode* emitLBVH(BVHBuildNode*& buildNodes,
+			const std::vector<BVHPrimitiveInfo>& primitiveInfo,
+			const MortonPrimitive* mortonPrims, int start, int nPrimitives, int* totalNodes,
+			std::vector<PrimitiveRef>& orderedPrims, int bitIndex) const;
+		BVHBuildNode* buildUpperSAH(MemoryArena& arena,
+			std::vector<BVHBuildNode*>& treeletRoots,
+			int start, int end, std::atomic<int>* totalNodes) const;
+		Bounds3f refBound(const PrimitiveRef& ref) const {
+			if (ref.triIndex >= 0)
+				return meshPrimitives[ref.primIndex]->TriangleBound(ref.triIndex);
+			return primitives[ref.primIndex]->WorldBound();
+		}
+		bool intersectRef(const PrimitiveRef& ref, const Ray& ray, SurfaceInteraction* isect) const {
+			if (ref.triIndex >= 0)
+				return meshPrimitives[ref.primIndex]->IntersectTriangle(ref.triIndex, ray, isect);
+			return primitives[ref.primIndex]->Intersect(ray, isect);
+		}
+		// timeʱ̣˶Ĺؼ֡İΧУͼԪ˶̵İΧ
+		Bounds3f refBound(const PrimitiveRef& ref, float time) const {
+			if (ref.triIndex >= 0)
+				return meshPrimitives[ref.primIndex]->TriangleBound(ref.triIndex, time);
+			return primitives[ref.primIndex]->WorldBound();
+		}
+		// ʱڽڵ˵İΧ֮Բֵ˶ʱ԰ʱ̵ͼԪ
+		Bounds3f motionNodeBounds(int nodeIndex, float time) const {
+			const Bounds3f* b = &motionBounds[2 * nodeIndex];
+			return Bounds3f(Lerp(time, b[0].pMin, b[1].pMin), Lerp(time, b[0].pMax, b[1].pMax));
+		}
+		void updateMotionBounds();
+		bool intersectPRef(const PrimitiveRef& ref, const Ray& ray) const {
+			if (ref.triIndex >= 0)
+				return meshPrimitives[ref.primIndex]->IntersectPTriangle(ref.triIndex, ray);
+			return primitives[ref.primIndex]->IntersectP(ray);
+		}
+		// ֻ¼ν(±)
+		// ΪһSurfaceInteraction
+		struct DeferredHit {
+			int refIndex = -1;
+			float b[3];
+		};
+		bool intersectLeaf(int offset, int nPrimitives, const Ray& ray,
+			const TriangleBlockRay& blockRay, SurfaceInteraction* isect,
+			DeferredHit* deferred) const;
+		bool intersectPLeaf(int offset, int nPrimitives, const Ray& ray,
+			const TriangleBlockRay& blockRay) const;
+		template <int W>
+		TriangleBlock<W>* buildTriangleBlocks(int totalNodes);
+		template <int W>
+		bool intersectBlocks(const TriangleBlock<W>* blocks, int offset, int nPrimitives,
+			const Ray& ray, const TriangleBlockRay& blockRay, SurfaceInteraction* isect,
+			DeferredHit* deferred) const;
+		template <int W>
+		bool intersectPBlocks(const TriangleBlock<W>* blocks, int offset, int nPrimitives,
+			const Ray& ray, const TriangleBlockRay& blockRay) const;
+		void finishDeferredHit(const DeferredHit& deferred, const Ray& ray,
+			SurfaceInteraction* isect) const;
+		MemoryArena& newBuildArena();
 		//ıƽ
 		int flattenBVHTree(BVHBuildNode* node, int* offset);
+		//۵
+		template <int N>
+		WideBVHNode<N>* collapseWideTree() const;
+		template <int N>
+		bool intersectWide(const WideBVHNode<N>* wideNodes, const Ray& ray,
+			SurfaceInteraction* isect) const;
+		template <int N>
+		bool intersectPWide(const WideBVHNode<N>* wideNodes, const Ray& ray) const;
 		const int maxPrimsInNode;
 		const SplitMethod splitMethod;
+		const int treeWidth;
+		const int blockWidth;
+		// ͼԪmeshPrimitives[i]primitives[i]ͼԪʱָΪ
 		std::vector<std::shared_ptr<Primitive>> primitives;
+		std::vector<const TriangleMeshPrimitive*> meshPrimitives;
+		// Ҷ˳еͼԪ
+		std::vector<PrimitiveRef> primitiveRefs;
 		LinearBVHNode* nodes = nullptr;
+		int totalNodes = 0;
+		// ˶ģ˶ʱڵڿˣtime=0/1İΧУ
+		// motionBounds[2 * i][2 * i + 1]nodes[i].boundsΪİΧ
+		Bounds3f* motionBounds = nullptr;
+		// ʱSAH
+		float buildCost = 0;
+		WideBVHNode<4>* wideNodes4 = nullptr;
+		WideBVHNode<8>* wideNodes8 = nullptr;
+		// ο飻ʱҶӵprimitivesOffsetָ±
+		TriangleBlock<4>* triBlocks4 = nullptr;
+		TriangleBlock<8>* triBlocks8 = nullptr;
+		// ʹõ߳ݹ
+		int buildThreads = 1;
+		int maxSpawnDepth = 0;
+		// нʱڴأƽͷ
+		std::vector<std::unique_ptr<MemoryArena>> buildArenas;
+		std::mutex buildArenasMutex;
 	};
 
 }
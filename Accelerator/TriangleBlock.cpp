@@ -0,0 +1,167 @@
+#include "Accelerator\TriangleBlock.h"
+#include <immintrin.h>
+
+namespace PBR {
+
+	TriangleBlockRay::TriangleBlockRay(const Ray& ray) {
+		kz = MaxDimension(Abs(ray.d));
+		kx = kz + 1;
+		if (kx == 3) kx = 0;
+		ky = kx + 1;
+		if (ky == 3) ky = 0;
+		Vector3f d = Permute(ray.d, kx, ky, kz);
+		Sx = -d.x / d.z;
+		Sy = -d.y / d.z;
+		Sz = 1.f / d.z;
+		o[0] = ray.o.x;
+		o[1] = ray.o.y;
+		o[2] = ray.o.z;
+	}
+
+	// 4/8ͨSIMDıװͬһ󽻴ֱʵΪSSEAVX汾
+	struct SSE4 {
+		typedef __m128 F;
+		static F load(const float* p) { return _mm_load_ps(p); }
+		static void store(float* p, F a) { _mm_storeu_ps(p, a); }
+		static F set1(float a) { return _mm_set1_ps(a); }
+		static F add(F a, F b) { return _mm_add_ps(a, b); }
+		static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+		static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+		static F div(F a, F b) { return _mm_div_ps(a, b); }
+		static F max(F a, F b) { return _mm_max_ps(a, b); }
+		static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+		static F And(F a, F b) { return _mm_and_ps(a, b); }
+		static F Or(F a, F b) { return _mm_or_ps(a, b); }
+		static F eq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+		static F lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+		static F le(F a, F b) { return _mm_cmple_ps(a, b); }
+		static F gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+		static F ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+		static int movemask(F a) { return _mm_movemask_ps(a); }
+		static const int W = 4;
+	};
+
+#if defined(__AVX__)
+	struct AVX8 {
+		typedef __m256 F;
+		static F load(const float* p) { return _mm256_load_ps(p); }
+		static void store(float* p, F a) { _mm256_storeu_ps(p, a); }
+		static F set1(float a) { return _mm256_set1_ps(a); }
+		static F add(F a, F b) { return _mm256_add_ps(a, b); }
+		static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+		static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+		static F div(F a, F b) { return _mm256_div_ps(a, b); }
+		static F max(F a, F b) { return _mm256_max_ps(a, b); }
+		static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+		static F And(F a, F b) { return _mm256_and_ps(a, b); }
+		static F Or(F a, F b) { return _mm256_or_ps(a, b); }
+		static F eq(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+		static F lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static F le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static F gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static F ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static int movemask(F a) { return _mm256_movemask_ps(a); }
+		static const int W = 8;
+	};
+#endif
+
+	// pָp[0][0][0]ڵ[][]֮stridefloat
+	// ˳TriangleHit֤ͬ汾һ
+	template <typename S>
+	static inline int intersectLanes(const float* p, int stride, const TriangleBlockRay& r,
+		float tMax, float* tHit, float* b0Out, float* b1Out, float* b2Out, int* fallbackMask) {
+		typedef typename S::F F;
+		const F zero = S::set1(0.f);
+		// ƽƣƵԭ㣻ûֱӰkx/ky/kzȡӦ
+		F ox = S::set1(r.o[r.kx]), oy = S::set1(r.o[r.ky]), oz = S::set1(r.o[r.kz]);
+		F p0x = S::sub(S::load(p + (0 * 3 + r.kx) * stride), ox);
+		F p0y = S::sub(S::load(p + (0 * 3 + r.ky) * stride), oy);
+		F p0z = S::sub(S::load(p + (0 * 3 + r.kz) * stride), oz);
+		F p1x = S::sub(S::load(p + (1 * 3 + r.kx) * stride), ox);
+		F p1y = S::sub(S::load(p + (1 * 3 + r.ky) * stride), oy);
+		F p1z = S::sub(S::load(p + (1 * 3 + r.kz) * stride), oz);
+		F p2x = S::sub(S::load(p + (2 * 3 + r.kx) * stride), ox);
+		F p2y = S::sub(S::load(p + (2 * 3 + r.ky) * stride), oy);
+		F p2z = S::sub(S::load(p + (2 * 3 + r.kz) * stride), oz);
+		// 
+		F sx = S::set1(r.Sx), sy = S::set1(r.Sy);
+		p0x = S::add(p0x, S::mul(sx, p0z));
+		p0y = S::add(p0y, S::mul(sy, p0z));
+		p1x = S::add(p1x, S::mul(sx, p1z));
+		p1y = S::add(p1y, S::mul(sy, p1z));
+		p2x = S::add(p2x, S::mul(sx, p2z));
+		p2y = S::add(p2y, S::mul(sy, p2z));
+		// ߺ
+		F e0 = S::sub(S::mul(p1x, p2y), S::mul(p1y, p2x));
+		F e1 = S::sub(S::mul(p2x, p0y), S::mul(p2y, p0x));
+		F e2 = S::sub(S::mul(p0x, p1y), S::mul(p0y, p1x));
+		*fallbackMask = S::movemask(S::Or(S::Or(S::eq(e0, zero), S::eq(e1, zero)), S::eq(e2, zero)));
+
+		// ߺ
+		F reject = S::And(
+			S::Or(S::Or(S::lt(e0, zero), S::lt(e1, zero)), S::lt(e2, zero)),
+			S::Or(S::Or(S::gt(e0, zero), S::gt(e1, zero)), S::gt(e2, zero)));
+		F det = S::add(S::add(e0, e1), e2);
+		reject = S::Or(reject, S::eq(det, zero));
+
+		// t[0, tMax]Ƚ
+		F sz = S::set1(r.Sz);
+		p0z = S::mul(p0z, sz);
+		p1z = S::mul(p1z, sz);
+		p2z = S::mul(p2z, sz);
+		F tScaled = S::add(S::add(S::mul(e0, p0z), S::mul(e1, p1z)), S::mul(e2, p2z));
+		F tMaxDet = S::mul(S::set1(tMax), det);
+		reject = S::Or(reject, S::And(S::lt(det, zero),
+			S::Or(S::ge(tScaled, zero), S::lt(tScaled, tMaxDet))));
+		reject = S::Or(reject, S::And(S::gt(det, zero),
+			S::Or(S::le(tScaled, zero), S::gt(tScaled, tMaxDet))));
+
+		F invDet = S::div(S::set1(1.f), det);
+		F t = S::mul(tScaled, invDet);
+
+		// 㣺tϽ
+		F maxZt = S::max(S::abs(p0z), S::max(S::abs(p1z), S::abs(p2z)));
+		F maxXt = S::max(S::abs(p0x), S::max(S::abs(p1x), S::abs(p2x)));
+		F maxYt = S::max(S::abs(p0y), S::max(S::abs(p1y), S::abs(p2y)));
+		F deltaZ = S::mul(S::set1(gamma(3)), maxZt);
+		F deltaX = S::mul(S::set1(gamma(5)), S::add(maxXt, maxZt));
+		F deltaY = S::mul(S::set1(gamma(5)), S::add(maxYt, maxZt));
+		F deltaE = S::mul(S::set1(2.f), S::add(S::add(
+			S::mul(S::mul(S::set1(gamma(2)), maxXt), maxYt),
+			S::mul(deltaY, maxXt)), S::mul(deltaX, maxYt)));
+		F maxE = S::max(S::abs(e0), S::max(S::abs(e1), S::abs(e2)));
+		F deltaT = S::mul(S::mul(S::set1(3.f), S::add(S::add(
+			S::mul(S::mul(S::set1(gamma(3)), maxE), maxZt),
+			S::mul(deltaE, maxZt)), S::mul(deltaZ, maxE))), S::abs(invDet));
+		reject = S::Or(reject, S::le(t, deltaT));
+
+		S::store(tHit, t);
+		S::store(b0Out, S::mul(e0, invDet));
+		S::store(b1Out, S::mul(e1, invDet));
+		S::store(b2Out, S::mul(e2, invDet));
+		return ~S::movemask(reject) & ((1 << S::W) - 1);
+	}
+
+	int IntersectTriangleBlock(const TriangleBlock<4>& block, const TriangleBlockRay& r,
+		float tMax, float tHit[4], float b[3][4], int* fallbackMask) {
+		return intersectLanes<SSE4>(&block.p[0][0][0], 4, r, tMax, tHit,
+			b[0], b[1], b[2], fallbackMask);
+	}
+
+	int IntersectTriangleBlock(const TriangleBlock<8>& block, const TriangleBlockRay& r,
+		float tMax, float tHit[8], float b[3][8], int* fallbackMask) {
+#if defined(__AVX__)
+		return intersectLanes<AVX8>(&block.p[0][0][0], 8, r, tMax, tHit,
+			b[0], b[1], b[2], fallbackMask);
+#else
+		// δAVXʱSSE
+		int fallbackLo, fallbackHi;
+		const float* p = &block.p[0][0][0];
+		int hitLo = intersectLanes<SSE4>(p, 8, r, tMax, tHit, b[0], b[1], b[2], &fallbackLo);
+		int hitHi = intersectLanes<SSE4>(p + 4, 8, r, tMax, tHit + 4,
+			b[0] + 4, b[1] + 4, b[2] + 4, &fallbackHi);
+		*fallbackMask = fallbackLo | (fallbackHi << 4);
+		return hitLo | (hitHi << 4);
+#endif
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef TRIANGLEBLOCK_H
+#define TRIANGLEBLOCK_H
+
+#include "Core\PBR.h"
+#include "Core\Geometry.h"
+
+namespace PBR {
+	// רõο飺WεĶ㰴SoAִţp[][][ͨ]
+	// 㰴BVHҶ˳򿽱һݣҶʱپ
+	template <int W>
+	struct alignas(64) TriangleBlock {
+		float p[3][3][W];
+		// ͨӦͼԪ±꣨BVHAccel::primitiveRefsͨΪ-1
+		int refIndex[W];
+		// εͨǿͨͨͼԪ߱·
+		int triMask;
+	};
+
+	// ÿֻһεûвTriangleHitеļͬ
+	struct TriangleBlockRay {
+		TriangleBlockRay() {}
+		TriangleBlockRay(const Ray& ray);
+		int kx, ky, kz;
+		float o[3];
+		float Sx, Sy, Sz;
+	};
+
+	// SIMDˮ󽻣ԿͨͬʱִTriangleHitͬĲԣλһ¡
+	// ͨԵͨ룬ͨtb0/b1/b2
+	// ߺΪ0ͨҪ˫㣬fallbackMaskУɵ߸TriangleHit
+	int IntersectTriangleBlock(const TriangleBlock<4>& block, const TriangleBlockRay& r,
+		float tMax, float tHit[4], float b[3][4], int* fallbackMask);
+	int IntersectTriangleBlock(const TriangleBlock<8>& block, const TriangleBlockRay& r,
+		float tMax, float tHit[8], float b[3][8], int* fallbackMask);
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "Camera\Camera.h"
+#include "Core\MappedFile.h"
 
 namespace PBR {
 	float Camera::GenerateRayDifferential(const CameraSample& sample,
@@ -44,4 +45,19 @@ namespace PBR {
 		rd->hasDifferentials = true;
 		return wt;
 	}
+
+	uint64_t Camera::ParameterHash() const {
+		uint64_t h = HashBytes(CameraToWorld.GetMatrix().m, sizeof(float) * 16);
+		h = HashBytes(&shutterOpen, sizeof(float), h);
+		return HashBytes(&shutterClose, sizeof(float), h);
+	}
+
+	uint64_t ProjectiveCamera::ParameterHash() const {
+		// ӳǡƬֱĻڶCameraToScreenScreenToRaster
+		uint64_t h = Camera::ParameterHash();
+		h = HashBytes(CameraToScreen.GetMatrix().m, sizeof(float) * 16, h);
+		h = HashBytes(ScreenToRaster.GetMatrix().m, sizeof(float) * 16, h);
+		h = HashBytes(&lensRadius, sizeof(float), h);
+		return HashBytes(&focalDistance, sizeof(float), h);
+	}
 }
@@ -24,9 +24,13 @@ namespace PBR {
 		virtual ~Camera() {}
 		virtual float GenerateRay(const CameraSample& sample, Ray* ray) const { return 1; };
 		virtual float GenerateRayDifferential(const CameraSample& sample, RayDifferential* rd) const;
+		// 任ŵȣĹϣȾϵж϶ϵǷͬһ
+		virtual uint64_t ParameterHash() const;
 		// ռ䵽ռ
 		Transform CameraToWorld;
 		const Medium* medium;
+		// ſرյʱ̣CameraSample::timeӳΪߵtime˶ģ
+		float shutterOpen = 0, shutterClose = 1;
 	};
 
 	class ProjectiveCamera : public Camera {
@@ -53,6 +57,8 @@ namespace PBR {
 			RasterToCamera = Inverse(CameraToScreen) * RasterToScreen;
 		}
 
+		uint64_t ParameterHash() const;
+
 	protected:
 		// ProjectiveCamera Protected Data
 		Transform CameraToScreen, RasterToCamera;
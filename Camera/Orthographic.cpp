@@ -20,6 +20,7 @@ namespace PBR {
 			ray->d = Normalize(pFocus - ray->o);
 		}
 		ray->medium = medium;
+		ray->time = Lerp(sample.time, shutterOpen, shutterClose);
 		*ray = CameraToWorld(*ray);
 		return 1;
 	}
@@ -58,6 +59,7 @@ namespace PBR {
 		}
 		ray->hasDifferentials = true;
 		ray->medium = medium;
+		ray->time = Lerp(sample.time, shutterOpen, shutterClose);
 		*ray = CameraToWorld(*ray);
 		return 1;
 	}
@@ -37,6 +37,7 @@ namespace PBR {
 			ray->o = Point3f(pLens.x, pLens.y, 0);
 			ray->d = Normalize(pFocus - ray->o);
 		}
+		ray->time = Lerp(sample.time, shutterOpen, shutterClose);
 		*ray = CameraToWorld(*ray);
 		return 1;
 	}
@@ -74,6 +75,7 @@ namespace PBR {
 			ray->rxDirection = Normalize(Vector3f(pCamera) + dxCamera);
 			ray->ryDirection = Normalize(Vector3f(pCamera) + dyCamera);
 		}
+		ray->time = Lerp(sample.time, shutterOpen, shutterClose);
 		*ray = CameraToWorld(*ray);
 		ray->hasDifferentials = true;
 		return 1;
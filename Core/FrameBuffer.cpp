@@ -1,25 +1,39 @@
 #pragma once
 #include "FrameBuffer.h"
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+#include "Core\PBR.h"
+#include "Core\Spectrum.h"
+#include "include\stb_image_write.h"
+#include <algorithm>
+#include <string>
+
+void FrameBuffer::Resolve() {
+	if (nullptr == accum || nullptr == fbuffer || nullptr == ubuffer) return;
+	int nPixels = width * height;
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < nPixels; ++i) {
+		const float* p = accum + i * 4;
+		float rgb[3] = { 0.f, 0.f, 0.f };
+		if (p[3] > 0.f) {
+			float invWeight = 1.f / p[3];
+			for (int c = 0; c < 3; ++c) rgb[c] = std::max(0.f, p[c] * invWeight);
+		}
+		for (int c = 0; c < channals; ++c) {
+			// 4ͨΪAlpha̶Ϊ͸
+			float value = c < 3 ? rgb[c] : 1.f;
+			fbuffer[i * channals + c] = value;
+			ubuffer[i * channals + c] = c < 3 ?
+				(unsigned char)PBR::Clamp(255.f * PBR::GammaCorrect(value) + 0.5f, 0.f, 255.f) : 255;
+		}
+	}
+}
+
+bool FrameBuffer::WriteImage(const char* filename) const {
+	if (nullptr == ubuffer || nullptr == fbuffer) return false;
+	std::string name(filename);
+	bool hdr = name.size() > 4 && name.compare(name.size() - 4, 4, ".hdr") == 0;
+	// mainбʱԼһ£0ͼײ
+	stbi_flip_vertically_on_write(true);
+	if (hdr)
+		return stbi_write_hdr(filename, width, height, channals, fbuffer) != 0;
+	return stbi_write_png(filename, width, height, channals, ubuffer, width * channals) != 0;
+}
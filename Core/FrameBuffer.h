@@ -13,13 +13,16 @@ public:
 		height(height),
 		channals(channals),
 		ubuffer(nullptr),
-		fbuffer(nullptr) { }
+		fbuffer(nullptr),
+		accum(nullptr) { }
 
 	~FrameBuffer() {
 		if (nullptr != ubuffer) delete[] ubuffer;
 		if (nullptr != fbuffer) delete[] fbuffer;
+		if (nullptr != accum) delete[] accum;
 		ubuffer = nullptr;
 		fbuffer = nullptr;
+		accum = nullptr;
 		this->width = 0;
 		this->height = 0;
 		this->channals = 0;
@@ -31,28 +34,34 @@ public:
 		this->channals = channals;
 		ubuffer = nullptr;
 		fbuffer = nullptr;
+		accum = nullptr;
 		if (channals > 4) {
 			//TextDinodonS("Initialize Error: Channel is greater than 4!");
 			return;
 		}
 		ubuffer = new unsigned char[width * height * channals];
 		fbuffer = new float[width * height * channals];
-		if (nullptr == ubuffer || nullptr == fbuffer) {
+		accum = new float[width * height * 4]();
+		if (nullptr == ubuffer || nullptr == fbuffer || nullptr == accum) {
 			//TextDinodonS("Initialize Error: FrameBuffer has not applied for enough memory!");
 			this->width = 0;
 			this->height = 0;
 			this->channals = 0;
 			if (nullptr != ubuffer) delete[] ubuffer;
 			if (nullptr != fbuffer) delete[] fbuffer;
+			if (nullptr != accum) delete[] accum;
 			ubuffer = nullptr;
 			fbuffer = nullptr;
+			accum = nullptr;
 		}
 	}
 	void FreeBuffer() {
 		if (nullptr != ubuffer) delete[] ubuffer;
 		if (nullptr != fbuffer) delete[] fbuffer;
+		if (nullptr != accum) delete[] accum;
 		ubuffer = nullptr;
 		fbuffer = nullptr;
+		accum = nullptr;
 		this->width = 0;
 		this->height = 0;
 		this->channals = 0;
@@ -64,18 +73,22 @@ public:
 		}
 		if (nullptr != ubuffer) delete[] ubuffer;
 		if (nullptr != fbuffer) delete[] fbuffer;
+		if (nullptr != accum) delete[] accum;
 		this->width = width; this->height = height;
 		ubuffer = new unsigned char[width * height * channals];
 		fbuffer = new float[width * height * channals];
-		if (nullptr == ubuffer || nullptr == fbuffer) {
+		accum = new float[width * height * 4]();
+		if (nullptr == ubuffer || nullptr == fbuffer || nullptr == accum) {
 			//TextDinodonS("Resize Error: FrameBuffer has not applied for enough memory!");
 			this->width = 0;
 			this->height = 0;
 			this->channals = 0;
 			if (nullptr != ubuffer) delete[] ubuffer;
 			if (nullptr != fbuffer) delete[] fbuffer;
+			if (nullptr != accum) delete[] accum;
 			ubuffer = nullptr;
 			fbuffer = nullptr;
+			accum = nullptr;
 			return false;
 		}
 		return true;
@@ -124,12 +137,38 @@ public:
 		ubuffer[offset] = fbuffer[offset] * 255;
 		return true;
 	}
+	//HDRۼӣRGBȨۼӵϣÿصRGBȨغͶfloat
+	//ͬһͬһʱֻһ߳д루ȾʱƬּɱ֤
+	inline void AddSample(const int w, const int h, const float rgb[3], const float weight = 1.0f) {
+		float* p = accum + (w + h * width) * 4;
+		p[0] += weight * rgb[0];
+		p[1] += weight * rgb[1];
+		p[2] += weight * rgb[2];
+		p[3] += weight;
+	}
+	//ۼӻʼµһ֡
+	void ClearAccumulation() {
+		if (nullptr != accum) memset(accum, 0, sizeof(float) * width * height * 4);
+	}
+	//ۼӽһΪHDRͼдfbufferGammaдubuffer
+	//һȾ󶼿ԵãõǰԤ
+	void Resolve();
+	//ͼչΪ.hdrʱдfbufferеHDRдubufferPNG
+	bool WriteImage(const char* filename) const;
+
 	//LDR
 	unsigned char* getUCbuffer() { return ubuffer; }
+	//HDR
+	float* getFbuffer() { return fbuffer; }
+	//ۼӻÿΪRGBļȨȨغ
+	float* getAccumBuffer() { return accum; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
 
 private:
 	unsigned char* ubuffer;
 	float* fbuffer;
+	float* accum;
 	int width;
 	int height;
 	int channals;
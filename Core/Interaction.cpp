@@ -31,16 +31,12 @@ namespace PBR {
 		}
 	}
 
-	SurfaceInteraction::~SurfaceInteraction() {
-		if (bsdf)
-			bsdf->~BSDF();
-	}
 	//ɢ
 	void SurfaceInteraction::ComputeScatteringFunctions(const Ray& ray,
-		bool allowMultipleLobes,
+		MemoryArena& arena, bool allowMultipleLobes,
 		TransportMode mode) {
 		ComputeDifferentials(ray);
-		primitive->ComputeScatteringFunctions(this, mode,
+		primitive->ComputeScatteringFunctions(this, arena, mode,
 			allowMultipleLobes);
 	}
 
@@ -65,12 +65,12 @@ namespace PBR {
 	public:
 		MediumInteraction() : phase(nullptr) {}
 		MediumInteraction(const Point3f& p, const Vector3f& wo, float time,
-			const Medium* medium, PhaseFunction* phase)
+			const Medium* medium, const PhaseFunction* phase)
 			: Interaction(p, wo, time, medium), phase(phase) {}
 		bool IsValid() const { return phase != nullptr; }
 
-		// ָλָ
-		std::shared_ptr<PhaseFunction> phase = nullptr;
+		// λɽʳУָֻ
+		const PhaseFunction* phase = nullptr;
 	};
 
 	class SurfaceInteraction : public Interaction {
@@ -82,9 +82,8 @@ namespace PBR {
 			const Normal3f& dndu, const Normal3f& dndv, float time,
 			const Shape* sh,
 			int faceIndex = 0);
-		~SurfaceInteraction();
 		void ComputeScatteringFunctions(
-			const Ray& ray,
+			const Ray& ray, MemoryArena& arena,
 			bool allowMultipleLobes = false,
 			TransportMode mode = TransportMode::Radiance);
 
@@ -94,7 +93,8 @@ namespace PBR {
 
 
 		const Primitive* primitive = nullptr;
-		std::shared_ptr<BSDF> bsdf = nullptr;
+		// ָarenaеBSDFӵȨ
+		BSDF* bsdf = nullptr;
 		Point2f uv;
 		Vector3f dpdu, dpdv;
 		Normal3f dndu, dndv;
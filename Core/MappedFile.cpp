@@ -0,0 +1,215 @@
+#include "Core\MappedFile.h"
+#include <sys/stat.h>
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <cstdio>
+#include <cstring>
+
+namespace PBR {
+
+bool MappedFile::Open(const std::string &filename) {
+	Close();
+#if defined(_WIN32)
+	HANDLE f = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (f == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(f, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(f);
+		return false;
+	}
+	HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m) {
+		CloseHandle(f);
+		return false;
+	}
+	const void *view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+	if (!view) {
+		CloseHandle(m);
+		CloseHandle(f);
+		return false;
+	}
+	file = f;
+	mapping = m;
+	data = (const char *)view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// ӳ佨ļͿԹر
+	close(fd);
+	if (view == MAP_FAILED) return false;
+	data = (const char *)view;
+	size = (size_t)st.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close() {
+	if (!data) return;
+#if defined(_WIN32)
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	CloseHandle(file);
+	file = mapping = nullptr;
+#else
+	munmap((void *)data, size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+long long FileModifiedTime(const std::string &filename) {
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0) return -1;
+	return (long long)st.st_mtime;
+}
+
+long long FileSize(const std::string &filename) {
+#if defined(_WIN32)
+	// MSVCstruct statst_sizeֻ32λ
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &attributes)) return -1;
+	return ((long long)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+#else
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0) return -1;
+	return (long long)st.st_size;
+#endif
+}
+
+// MurmurHash64Aÿδ8ֽڣϣļʱڶٶ
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed) {
+	const uint64_t m = 0xc6a4a7935bd1e995ull;
+	const int r = 47;
+	const char *bytes = (const char *)data;
+	uint64_t h = 0x9e3779b97f4a7c15ull ^ seed ^ (size * m);
+	size_t nBlocks = size / 8;
+	for (size_t i = 0; i < nBlocks; ++i) {
+		uint64_t k;
+		memcpy(&k, bytes + 8 * i, 8);
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+	const unsigned char *tail = (const unsigned char *)bytes + 8 * nBlocks;
+	switch (size & 7) {
+	case 7: h ^= uint64_t(tail[6]) << 48; // fallthrough
+	case 6: h ^= uint64_t(tail[5]) << 40; // fallthrough
+	case 5: h ^= uint64_t(tail[4]) << 32; // fallthrough
+	case 4: h ^= uint64_t(tail[3]) << 24; // fallthrough
+	case 3: h ^= uint64_t(tail[2]) << 16; // fallthrough
+	case 2: h ^= uint64_t(tail[1]) << 8; // fallthrough
+	case 1: h ^= uint64_t(tail[0]);
+		h *= m;
+	}
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	return h;
+}
+
+uint64_t FileHash(const std::string &filename) {
+	MappedFile f;
+	if (!f.Open(filename)) return 0;
+	return HashBytes(f.Data(), f.Size());
+}
+
+AtomicFileWriter::AtomicFileWriter(const std::string &filename)
+	: filename(filename), tmpName(filename + ".tmp") {
+#if defined(_WIN32)
+	HANDLE f = CreateFileA(tmpName.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (f == INVALID_HANDLE_VALUE) return;
+	file = f;
+#else
+	fd = open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) return;
+#endif
+	ok = true;
+}
+
+AtomicFileWriter::~AtomicFileWriter() {
+	abort();
+}
+
+bool AtomicFileWriter::Write(const void *data, size_t size) {
+	const char *p = (const char *)data;
+	while (ok && size > 0) {
+		// ݷֶд룬дĳȲ1GB
+		size_t chunk = size < ((size_t)1 << 30) ? size : ((size_t)1 << 30);
+#if defined(_WIN32)
+		DWORD written = 0;
+		if (!WriteFile(file, p, (DWORD)chunk, &written, nullptr) || written == 0) ok = false;
+#else
+		ssize_t written = write(fd, p, chunk);
+		if (written <= 0) ok = false;
+#endif
+		if (!ok) break;
+		p += written;
+		size -= (size_t)written;
+	}
+	return ok;
+}
+
+bool AtomicFileWriter::Commit() {
+	if (!ok) {
+		abort();
+		return false;
+	}
+	// Ȱʱļˢ̣滻Ŀļԭӵ
+#if defined(_WIN32)
+	bool flushed = FlushFileBuffers(file) != 0;
+	CloseHandle(file);
+	file = nullptr;
+	ok = false;
+	if (!flushed || !MoveFileExA(tmpName.c_str(), filename.c_str(),
+		MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		remove(tmpName.c_str());
+		return false;
+	}
+#else
+	bool flushed = fsync(fd) == 0;
+	flushed = close(fd) == 0 && flushed;
+	fd = -1;
+	ok = false;
+	if (!flushed || rename(tmpName.c_str(), filename.c_str()) != 0) {
+		remove(tmpName.c_str());
+		return false;
+	}
+#endif
+	return true;
+}
+
+void AtomicFileWriter::abort() {
+#if defined(_WIN32)
+	if (file) {
+		CloseHandle(file);
+		file = nullptr;
+		remove(tmpName.c_str());
+	}
+#else
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+		remove(tmpName.c_str());
+	}
+#endif
+	ok = false;
+}
+
+}
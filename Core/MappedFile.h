@@ -0,0 +1,71 @@
+#pragma once
+#ifndef __MappedFile_h__
+#define __MappedFile_h__
+
+#include "Core\PBR.h"
+#include <cstdint>
+#include <string>
+
+namespace PBR {
+
+// ֻڴӳļOpenļֱӳ䵽ַռ䣬
+// ɲϵͳҳ룬ҪһԶȡͽ
+class MappedFile {
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	// ӳļʧܣļڻΪգʱfalse
+	bool Open(const std::string &filename);
+	void Close();
+	const char *Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	const char *data = nullptr;
+	size_t size = 0;
+#if defined(_WIN32)
+	void *file = nullptr, *mapping = nullptr;
+#endif
+};
+
+// ļ޸ʱ䣬ļʱ-1
+long long FileModifiedTime(const std::string &filename);
+// ļֽļʱ-1
+long long FileSize(const std::string &filename);
+
+// 64λMurmurHashMurmurHash64AһݵĹϣΪseed룬԰Ѷݴһϣ
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 0);
+// ļݵĹϣļڻΪʱ0
+uint64_t FileHash(const std::string &filename);
+
+// ԭӵдļдfilename.tmpˢ̣Commitʱ滻filename
+// дʧܻ;ʱԭеfilenameֲ
+class AtomicFileWriter {
+public:
+	explicit AtomicFileWriter(const std::string &filename);
+	// ûCommitʱļʱɾ
+	~AtomicFileWriter();
+	AtomicFileWriter(const AtomicFileWriter &) = delete;
+	AtomicFileWriter &operator=(const AtomicFileWriter &) = delete;
+
+	bool Write(const void *data, size_t size);
+	bool Commit();
+
+private:
+	void abort();
+
+	std::string filename, tmpName;
+	bool ok = false;
+#if defined(_WIN32)
+	void *file = nullptr;
+#else
+	int fd = -1;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,28 @@
+#include "Core\Memory.h"
+#include <cstdlib>
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace PBR {
+
+void *AllocAligned(size_t size) {
+#if defined(_MSC_VER)
+	return _aligned_malloc(size, L1_CACHE_LINE_SIZE);
+#else
+	void *ptr;
+	if (posix_memalign(&ptr, L1_CACHE_LINE_SIZE, size) != 0) ptr = nullptr;
+	return ptr;
+#endif
+}
+
+void FreeAligned(void *ptr) {
+	if (!ptr) return;
+#if defined(_MSC_VER)
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+}
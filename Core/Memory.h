@@ -4,9 +4,94 @@
 
 
 #include "Core\PBR.h"
+#include <list>
+#include <new>
+#include <cstddef>
+#include <utility>
 
 namespace PBR{
 
+#define L1_CACHE_LINE_SIZE 64
+
+// ж/ͷڴ棬ɶʹ
+void *AllocAligned(size_t size);
+template <typename T>
+T *AllocAligned(size_t count) {
+	return (T *)AllocAligned(count * sizeof(T));
+}
+void FreeAligned(void *);
+
+// ڴйARENA_ALLOC(arena, Type)(...)
+#define ARENA_ALLOC(arena, Type) new ((arena).Alloc(sizeof(Type))) Type
+
+// ڴأ䣬󲻵ͷţReset()ʱա
+// ̰߳ȫ߳ʱÿ̸߳һ
+class MemoryArena {
+public:
+	MemoryArena(size_t blockSize = 262144) : blockSize(blockSize) {}
+	~MemoryArena() {
+		FreeAligned(currentBlock);
+		for (auto &block : usedBlocks) FreeAligned(block.second);
+		for (auto &block : availableBlocks) FreeAligned(block.second);
+	}
+	MemoryArena(const MemoryArena &) = delete;
+	MemoryArena &operator=(const MemoryArena &) = delete;
+
+	void *Alloc(size_t nBytes) {
+		// 16ֽڶ
+		const int align = alignof(std::max_align_t) > 16 ? alignof(std::max_align_t) : 16;
+		nBytes = (nBytes + align - 1) & ~(align - 1);
+		if (currentBlockPos + nBytes > currentAllocSize) {
+			// ǰ꣬бȸResetеĿ
+			if (currentBlock) {
+				usedBlocks.push_back(std::make_pair(currentAllocSize, currentBlock));
+				currentBlock = nullptr;
+				currentAllocSize = 0;
+			}
+			for (auto iter = availableBlocks.begin(); iter != availableBlocks.end(); ++iter) {
+				if (iter->first >= nBytes) {
+					currentAllocSize = iter->first;
+					currentBlock = iter->second;
+					availableBlocks.erase(iter);
+					break;
+				}
+			}
+			if (!currentBlock) {
+				currentAllocSize = nBytes > blockSize ? nBytes : blockSize;
+				currentBlock = AllocAligned<uint8_t>(currentAllocSize);
+			}
+			currentBlockPos = 0;
+		}
+		void *ret = currentBlock + currentBlockPos;
+		currentBlockPos += nBytes;
+		return ret;
+	}
+	template <typename T>
+	T *Alloc(size_t n = 1, bool runConstructor = true) {
+		T *ret = (T *)Alloc(n * sizeof(T));
+		if (runConstructor)
+			for (size_t i = 0; i < n; ++i) new (&ret[i]) T();
+		return ret;
+	}
+	// ȫڴԱ㸴ã
+	void Reset() {
+		currentBlockPos = 0;
+		availableBlocks.splice(availableBlocks.begin(), usedBlocks);
+	}
+	size_t TotalAllocated() const {
+		size_t total = currentAllocSize;
+		for (const auto &alloc : usedBlocks) total += alloc.first;
+		for (const auto &alloc : availableBlocks) total += alloc.first;
+		return total;
+	}
+
+private:
+	const size_t blockSize;
+	size_t currentBlockPos = 0, currentAllocSize = 0;
+	uint8_t *currentBlock = nullptr;
+	std::list<std::pair<size_t, uint8_t *>> usedBlocks, availableBlocks;
+};
+
 template <typename T, int logBlockSize>
 class BlockedArray {
 public:
@@ -122,6 +122,7 @@ namespace PBR{
 
 	template <typename T, int logBlockSize = 2>
 	class BlockedArray;
+	class MemoryArena;
 
 	inline float InverseGammaCorrect(float value) {
 		if (value <= 0.04045f) return value * 1.f / 12.92f;
@@ -1,17 +1,17 @@
 #include "Core\Primitive.h"
 #include "Shape\Shape.h"
+#include "Shape\Triangle.h"
 #include "Core\Interaction.h"
+#include "Core\Stats.h"
 
 
 namespace PBR {
 
-	static long long primitiveMemory = 0;
-
 	Primitive::~Primitive() {}
 	GeometricPrimitive::GeometricPrimitive(const std::shared_ptr<Shape>& shape,
 		const std::shared_ptr<Material>& material, const std::shared_ptr<AreaLight>& areaLight, const MediumInterface& mediumInterface)
 		: shape(shape), material(material), areaLight(areaLight), mediumInterface(mediumInterface) {
-		primitiveMemory += sizeof(*this);
+		STAT_ADD(PrimitiveBytes, sizeof(*this));
 	}
 	//ίи״
 	Bounds3f GeometricPrimitive::WorldBound() const { return shape->WorldBound(); }
@@ -37,10 +37,10 @@ namespace PBR {
 	}
 	//ίи
 	void GeometricPrimitive::ComputeScatteringFunctions(
-		SurfaceInteraction* isect, TransportMode mode,
+		SurfaceInteraction* isect, MemoryArena& arena, TransportMode mode,
 		bool allowMultipleLobes) const {
 		if (material)
-			material->ComputeScatteringFunctions(isect, mode,
+			material->ComputeScatteringFunctions(isect, arena, mode,
 				allowMultipleLobes);
 		//CHECK_GE(Dot(isect->n, isect->shading.n), 0.);
 	}
@@ -52,4 +52,166 @@ namespace PBR {
 	const AreaLight* GeometricPrimitive::GetAreaLight() const {
 		return areaLight.get();
 	}
-}
\ No newline at end of file
+
+	TriangleMeshPrimitive::TriangleMeshPrimitive(const std::shared_ptr<TriangleMesh>& mesh,
+		const Transform& ObjectToWorld, const std::shared_ptr<Material>& material,
+		const MediumInterface& mediumInterface, bool reverseOrientation)
+		: mesh(mesh), material(material), mediumInterface(mediumInterface),
+		nTriangles(mesh->nTriangles), reverseOrientation(reverseOrientation),
+		transformSwapsHandedness(ObjectToWorld.SwapsHandedness()),
+		hasMotion(mesh->HasMotion()) {
+		STAT_ADD(PrimitiveBytes, sizeof(*this));
+	}
+
+	Bounds3f TriangleMeshPrimitive::WorldBound() const {
+		Bounds3f bounds;
+		for (int i = 0; i < mesh->nVertices; ++i)
+			bounds = Union(bounds, mesh->p[i]);
+		if (hasMotion)
+			for (int i = 0; i < mesh->nVertices; ++i)
+				bounds = Union(bounds, mesh->p1[i]);
+		return bounds;
+	}
+
+	Bounds3f TriangleMeshPrimitive::TriangleBound(int triIndex) const {
+		return TriangleWorldBound(*mesh, &mesh->vertexIndices[3 * triIndex]);
+	}
+
+	Bounds3f TriangleMeshPrimitive::TriangleBound(int triIndex, float time) const {
+		return TriangleWorldBound(*mesh, &mesh->vertexIndices[3 * triIndex], time);
+	}
+
+	//GeometricPrimitive::Intersectֻͬ״еһ
+	bool TriangleMeshPrimitive::IntersectTriangle(int triIndex, const Ray& r,
+		SurfaceInteraction* isect) const {
+		float tHit;
+		int faceIndex = mesh->faceIndices.size() ? mesh->faceIndices[triIndex] : 0;
+		if (!PBR::IntersectTriangle(*mesh, &mesh->vertexIndices[3 * triIndex], faceIndex,
+			r, &tHit, isect, reverseOrientation, transformSwapsHandedness, nullptr))
+			return false;
+		r.tMax = tHit;
+		isect->primitive = this;
+		if (mediumInterface.IsMediumTransition())
+			isect->mediumInterface = mediumInterface;
+		else
+			isect->mediumInterface = MediumInterface(r.medium);
+		return true;
+	}
+
+	bool TriangleMeshPrimitive::IntersectPTriangle(int triIndex, const Ray& r) const {
+		return PBR::IntersectPTriangle(*mesh, &mesh->vertexIndices[3 * triIndex], r);
+	}
+
+	bool TriangleMeshPrimitive::TriangleHit(int triIndex, const Ray& r,
+		float* tHit, float b[3]) const {
+		return PBR::TriangleHit(*mesh, &mesh->vertexIndices[3 * triIndex], r, tHit, b);
+	}
+
+	void TriangleMeshPrimitive::TriangleInteraction(int triIndex, const Ray& r,
+		const float b[3], SurfaceInteraction* isect) const {
+		int faceIndex = mesh->faceIndices.size() ? mesh->faceIndices[triIndex] : 0;
+		PBR::TriangleInteraction(*mesh, &mesh->vertexIndices[3 * triIndex], faceIndex,
+			r, b, isect, reverseOrientation, transformSwapsHandedness, nullptr);
+		isect->primitive = this;
+		if (mediumInterface.IsMediumTransition())
+			isect->mediumInterface = mediumInterface;
+		else
+			isect->mediumInterface = MediumInterface(r.medium);
+	}
+
+	void TriangleMeshPrimitive::TriangleVertices(int triIndex, Point3f p[3]) const {
+		const int* v = &mesh->vertexIndices[3 * triIndex];
+		p[0] = mesh->p[v[0]];
+		p[1] = mesh->p[v[1]];
+		p[2] = mesh->p[v[2]];
+	}
+
+	//ҵΣֻΪһSurfaceInteraction
+	bool TriangleMeshPrimitive::Intersect(const Ray& r, SurfaceInteraction* isect) const {
+		int closest = -1;
+		float b[3];
+		for (int i = 0; i < nTriangles; ++i) {
+			float tHit, bHit[3];
+			if (TriangleHit(i, r, &tHit, bHit)) {
+				r.tMax = tHit;
+				closest = i;
+				b[0] = bHit[0];
+				b[1] = bHit[1];
+				b[2] = bHit[2];
+			}
+		}
+		if (closest < 0) return false;
+		TriangleInteraction(closest, r, b, isect);
+		return true;
+	}
+
+	bool TriangleMeshPrimitive::IntersectP(const Ray& r) const {
+		for (int i = 0; i < nTriangles; ++i)
+			if (IntersectPTriangle(i, r)) return true;
+		return false;
+	}
+
+	const Material* TriangleMeshPrimitive::GetMaterial() const {
+		return material.get();
+	}
+
+	void TriangleMeshPrimitive::ComputeScatteringFunctions(
+		SurfaceInteraction* isect, MemoryArena& arena, TransportMode mode,
+		bool allowMultipleLobes) const {
+		if (material)
+			material->ComputeScatteringFunctions(isect, arena, mode,
+				allowMultipleLobes);
+	}
+
+	TransformedPrimitive::TransformedPrimitive(const std::shared_ptr<Primitive>& primitive,
+		const Transform& PrimitiveToWorld)
+		: TransformedPrimitive(primitive, AnimatedTransform(PrimitiveToWorld, 0, PrimitiveToWorld, 1)) {}
+
+	TransformedPrimitive::TransformedPrimitive(const std::shared_ptr<Primitive>& primitive,
+		const AnimatedTransform& PrimitiveToWorld)
+		: primitive(primitive), PrimitiveToWorld(PrimitiveToWorld),
+		WorldToPrimitive(Inverse(PrimitiveToWorld.StartTransform())) {
+		STAT_ADD(PrimitiveBytes, sizeof(*this));
+	}
+
+	void TransformedPrimitive::SetTransform(const Transform& PrimitiveToWorld) {
+		SetTransform(AnimatedTransform(PrimitiveToWorld, 0, PrimitiveToWorld, 1));
+	}
+
+	void TransformedPrimitive::SetTransform(const AnimatedTransform& PrimitiveToWorld) {
+		this->PrimitiveToWorld = PrimitiveToWorld;
+		WorldToPrimitive = Inverse(PrimitiveToWorld.StartTransform());
+	}
+
+	//˶ʵİΧи˶
+	Bounds3f TransformedPrimitive::WorldBound() const {
+		return PrimitiveToWorld.MotionBounds(primitive->WorldBound());
+	}
+
+	//任ı߲tռеtMaxֱдռĹ
+	bool TransformedPrimitive::Intersect(const Ray& r, SurfaceInteraction* isect) const {
+		// ˶ʵߵtimeֵ任
+		const Transform* primToWorld = &PrimitiveToWorld.StartTransform();
+		const Transform* worldToPrim = &WorldToPrimitive;
+		Transform interpolated, interpolatedInv;
+		if (PrimitiveToWorld.IsAnimated()) {
+			PrimitiveToWorld.Interpolate(r.time, &interpolated);
+			interpolatedInv = Inverse(interpolated);
+			primToWorld = &interpolated;
+			worldToPrim = &interpolatedInv;
+		}
+		Ray ray = (*worldToPrim)(r);
+		if (!primitive->Intersect(ray, isect)) return false;
+		r.tMax = ray.tMax;
+		if (!primToWorld->IsIdentity()) *isect = (*primToWorld)(*isect);
+		return true;
+	}
+
+	bool TransformedPrimitive::IntersectP(const Ray& r) const {
+		if (!PrimitiveToWorld.IsAnimated())
+			return primitive->IntersectP(WorldToPrimitive(r));
+		Transform InterpolatedPrimToWorld;
+		PrimitiveToWorld.Interpolate(r.time, &InterpolatedPrimToWorld);
+		return primitive->IntersectP(Inverse(InterpolatedPrimToWorld)(r));
+	}
+}
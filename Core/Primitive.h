@@ -3,10 +3,12 @@
 #define PREMITIVE_H
 
 #include "Core\Geometry.h"
+#include "Core\Transform.h"
 #include "Material\Material.h"
 #include "Media\Medium.h"
 
 namespace PBR {
+	struct TriangleMesh;
 	//ͼԪ
 	class Primitive {
 	public:
@@ -17,7 +19,7 @@ namespace PBR {
 		virtual const AreaLight* GetAreaLight() const = 0;
 		virtual const Material* GetMaterial() const = 0;
 		virtual void ComputeScatteringFunctions(SurfaceInteraction* isect,
-			TransportMode mode,
+			MemoryArena& arena, TransportMode mode,
 			bool allowMultipleLobes) const = 0;
 	};
 	//ͼԪ״ʡԴ
@@ -35,7 +37,7 @@ namespace PBR {
 		const AreaLight* GetAreaLight() const;
 		const Material* GetMaterial() const;
 		virtual void ComputeScatteringFunctions(SurfaceInteraction* isect,
-			TransportMode mode,
+			MemoryArena& arena, TransportMode mode,
 			bool allowMultipleLobes) const;
 	private:
 		std::shared_ptr<Material> material;
@@ -44,12 +46,86 @@ namespace PBR {
 		MediumInterface mediumInterface;
 	};
 
+	//ͼԪһݲʣBVH(, )ֱеΣ
+	//ΪÿδTriangleGeometricPrimitive
+	class TriangleMeshPrimitive : public Primitive {
+	public:
+		TriangleMeshPrimitive(const std::shared_ptr<TriangleMesh>& mesh,
+			const Transform& ObjectToWorld,
+			const std::shared_ptr<Material>& material,
+			const MediumInterface& mediumInterface,
+			bool reverseOrientation = false);
+		// ΪʹʱδBVHչ
+		Bounds3f WorldBound() const;
+		bool Intersect(const Ray& r, SurfaceInteraction* isect) const;
+		bool IntersectP(const Ray& r) const;
+		const AreaLight* GetAreaLight() const { return nullptr; }
+		const Material* GetMaterial() const;
+		void ComputeScatteringFunctions(SurfaceInteraction* isect,
+			MemoryArena& arena, TransportMode mode,
+			bool allowMultipleLobes) const;
+
+		// εĽӿڣBVHҶֱӵã麯
+		int NumTriangles() const { return nTriangles; }
+		Bounds3f TriangleBound(int triIndex) const;
+		// ˶timeʱ̵İΧ
+		Bounds3f TriangleBound(int triIndex, float time) const;
+		bool HasMotion() const { return hasMotion; }
+		bool IntersectTriangle(int triIndex, const Ray& r, SurfaceInteraction* isect) const;
+		bool IntersectPTriangle(int triIndex, const Ray& r) const;
+		// ӳٹ죺ʱֻˮܲԣȷٹĽϢ
+		bool TriangleHit(int triIndex, const Ray& r, float* tHit, float b[3]) const;
+		void TriangleInteraction(int triIndex, const Ray& r, const float b[3],
+			SurfaceInteraction* isect) const;
+		void TriangleVertices(int triIndex, Point3f p[3]) const;
+
+	private:
+		std::shared_ptr<TriangleMesh> mesh;
+		std::shared_ptr<Material> material;
+		MediumInterface mediumInterface;
+		const int nTriangles;
+		const bool reverseOrientation, transformSwapsHandedness;
+		const bool hasMotion;
+	};
+
+	//任ͼԪʵһͼԪͨռ佨õBVHBLAS
+	//Լ嵽任ͬһöʱֻһݶBVH
+	//BVHTLASֻʵİΧС
+	//ʱѹ߱任ռ䣬кٰѽ任ռ
+	class TransformedPrimitive : public Primitive {
+	public:
+		TransformedPrimitive(const std::shared_ptr<Primitive>& primitive,
+			const Transform& PrimitiveToWorld);
+		// ˶ʵ任ߵtimeؼֵ֮֡˶ģ
+		TransformedPrimitive(const std::shared_ptr<Primitive>& primitive,
+			const AnimatedTransform& PrimitiveToWorld);
+		Bounds3f WorldBound() const;
+		bool Intersect(const Ray& r, SurfaceInteraction* isect) const;
+		bool IntersectP(const Ray& r) const;
+		// primitiveָʵڲʵеͼԪ½ӿڲᱻ
+		const AreaLight* GetAreaLight() const { return nullptr; }
+		const Material* GetMaterial() const { return nullptr; }
+		void ComputeScatteringFunctions(SurfaceInteraction* isect,
+			MemoryArena& arena, TransportMode mode,
+			bool allowMultipleLobes) const {}
+		// 嶯޸ʵı任԰BVHRefit
+		void SetTransform(const Transform& PrimitiveToWorld);
+		void SetTransform(const AnimatedTransform& PrimitiveToWorld);
+
+	private:
+		std::shared_ptr<Primitive> primitive;
+		// ֵ任ߵTransformڣ
+		// WorldToPrimitiveֻڱ任ʱ仯ʱʹ
+		AnimatedTransform PrimitiveToWorld;
+		Transform WorldToPrimitive;
+	};
+
 	//ۺͼԪڲͼԪûԼĲʻԴ
 	class Aggregate : public Primitive {
 	public:
 		// Aggregate Public Methods
 		virtual void ComputeScatteringFunctions(SurfaceInteraction* isect,
-			TransportMode mode,
+			MemoryArena& arena, TransportMode mode,
 			bool allowMultipleLobes) const {}
 		const AreaLight* GetAreaLight() const { return nullptr; }
 		const Material* GetMaterial() const { return nullptr; }
@@ -0,0 +1,94 @@
+#pragma once
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include "Core\PBR.h"
+#include "Core\Geometry.h"
+
+namespace PBR
+{
+    // λԪʾתAnimatedTransformؼֵ֮֡ת
+    struct Quaternion
+    {
+        Quaternion() : v(0, 0, 0), w(1) {}
+        // ӱ任תֹ
+        Quaternion(const Transform &t);
+        Transform ToTransform() const;
+
+        Quaternion &operator+=(const Quaternion &q)
+        {
+            v += q.v;
+            w += q.w;
+            return *this;
+        }
+        Quaternion operator+(const Quaternion &q) const
+        {
+            Quaternion ret = *this;
+            return ret += q;
+        }
+        Quaternion &operator-=(const Quaternion &q)
+        {
+            v -= q.v;
+            w -= q.w;
+            return *this;
+        }
+        Quaternion operator-() const
+        {
+            Quaternion ret;
+            ret.v = -v;
+            ret.w = -w;
+            return ret;
+        }
+        Quaternion operator-(const Quaternion &q) const
+        {
+            Quaternion ret = *this;
+            return ret -= q;
+        }
+        Quaternion &operator*=(float f)
+        {
+            v *= f;
+            w *= f;
+            return *this;
+        }
+        Quaternion operator*(float f) const
+        {
+            Quaternion ret = *this;
+            ret.v *= f;
+            ret.w *= f;
+            return ret;
+        }
+        Quaternion &operator/=(float f)
+        {
+            v /= f;
+            w /= f;
+            return *this;
+        }
+        Quaternion operator/(float f) const
+        {
+            Quaternion ret = *this;
+            ret.v /= f;
+            ret.w /= f;
+            return ret;
+        }
+
+        Vector3f v;
+        float w;
+    };
+
+    // ԲֵصλԪϵĴԲԺ㶨ٶȲֵ
+    Quaternion Slerp(float t, const Quaternion &q1, const Quaternion &q2);
+
+    inline Quaternion operator*(float f, const Quaternion &q) { return q * f; }
+
+    inline float Dot(const Quaternion &q1, const Quaternion &q2)
+    {
+        return Dot(q1.v, q2.v) + q1.w * q2.w;
+    }
+
+    inline Quaternion Normalize(const Quaternion &q)
+    {
+        return q / std::sqrt(Dot(q, q));
+    }
+}
+
+#endif // !QUATERNION_H
@@ -1,9 +1,7 @@
 #include "Core\Scene.h"
+#include "Core\Stats.h"
 
 namespace PBR {
-	static long long nIntersectionTests = 0;
-	static long long nShadowTests = 0;
-
 	Scene::Scene(std::shared_ptr<Primitive> aggregate,
 		const std::vector<std::shared_ptr<Light>>& lights)
 		: lights(lights), aggregate(aggregate) {
@@ -18,12 +16,12 @@ namespace PBR {
 
 	// Scene Method Definitions
 	bool Scene::Intersect(const Ray& ray, SurfaceInteraction* isect) const {
-		++nIntersectionTests;
+		STAT_INC(IntersectionRays);
 		return aggregate->Intersect(ray, isect);
 	}
 
 	bool Scene::IntersectP(const Ray& ray) const {
-		++nShadowTests;
+		STAT_INC(ShadowRays);
 		return aggregate->IntersectP(ray);
 	}
 
@@ -0,0 +1,70 @@
+#include "Core\Stats.h"
+
+#if PBR_STATS
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+
+namespace PBR {
+
+	thread_local long long threadStats[(int)Stat::Count];
+
+	static std::atomic<long long> totalStats[(int)Stat::Count];
+
+	void MergeThreadStats() {
+		for (int i = 0; i < (int)Stat::Count; ++i) {
+			if (threadStats[i] == 0) continue;
+			totalStats[i] += threadStats[i];
+			threadStats[i] = 0;
+		}
+	}
+
+	void ResetStats() {
+		// öгļMeshesʼ
+		for (int i = 0; i < (int)Stat::Meshes; ++i) {
+			threadStats[i] = 0;
+			totalStats[i] = 0;
+		}
+	}
+
+	static inline long long total(Stat stat) {
+		return totalStats[(int)stat].load();
+	}
+
+	static inline double ratio(long long a, long long b) {
+		return b > 0 ? double(a) / double(b) : 0.0;
+	}
+
+	void ReportStats(double renderSeconds) {
+		MergeThreadStats();
+		long long rays = total(Stat::IntersectionRays) + total(Stat::ShadowRays);
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << "Statistics:" << std::endl;
+		std::cout << "  Scene: " << total(Stat::Triangles) << " triangles in "
+			<< total(Stat::Meshes) << " meshes ("
+			<< total(Stat::TriangleMeshBytes) / (1024.0 * 1024.0) << " MB), primitives "
+			<< total(Stat::PrimitiveBytes) / (1024.0 * 1024.0) << " MB, MIP maps "
+			<< total(Stat::MIPMapBytes) / (1024.0 * 1024.0) << " MB, "
+			<< total(Stat::Shapes) << " shapes, " << total(Stat::Lights) << " lights ("
+			<< total(Stat::AreaLights) << " area)" << std::endl;
+		std::cout << "  Rays: " << rays << " (" << total(Stat::IntersectionRays)
+			<< " intersection, " << total(Stat::ShadowRays) << " shadow), "
+			<< rays / std::max(renderSeconds, 1e-6) / 1e6 << " M rays/s" << std::endl;
+		std::cout << "  BVH nodes visited per ray: "
+			<< ratio(total(Stat::BVHNodesVisited), rays) << std::endl;
+		std::cout << "  Triangle tests per ray: " << ratio(total(Stat::TriangleTests), rays)
+			<< ", hit rate " << 100 * ratio(total(Stat::TriangleHits), total(Stat::TriangleTests))
+			<< "%" << std::endl;
+		std::cout << "  Texture lookups: " << total(Stat::TrilerpLookups) << " trilinear, "
+			<< total(Stat::EWALookups) << " EWA" << std::endl;
+		if (total(Stat::Paths) > 0)
+			std::cout << "  Paths: " << total(Stat::Paths) << ", zero radiance "
+				<< 100 * ratio(total(Stat::ZeroRadiancePaths), total(Stat::Paths)) << "%" << std::endl;
+		if (total(Stat::VolumeInteractions) + total(Stat::SurfaceInteractions) > 0)
+			std::cout << "  Interactions: " << total(Stat::SurfaceInteractions) << " surface, "
+				<< total(Stat::VolumeInteractions) << " volume" << std::endl;
+	}
+
+}
+#endif
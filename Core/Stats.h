@@ -0,0 +1,54 @@
+#pragma once
+#ifndef __Stats_h__
+#define __Stats_h__
+
+#include "Core\PBR.h"
+
+// ͳƿأʱPBR_STATS=0CMakeѡPBR_ENABLE_STATS=OFFȫȥͳƴ
+#ifndef PBR_STATS
+#define PBR_STATS 1
+#endif
+
+namespace PBR {
+
+	// ȾͳƼ
+	enum class Stat {
+		// 
+		IntersectionRays, ShadowRays, BVHNodesVisited, TriangleTests, TriangleHits,
+		// 
+		TrilerpLookups, EWALookups,
+		// 
+		Paths, ZeroRadiancePaths, VolumeInteractions, SurfaceInteractions,
+		// 
+		Meshes, Triangles, TriangleMeshBytes, PrimitiveBytes, MIPMapBytes,
+		Shapes, Lights, AreaLights,
+		Count
+	};
+
+#if PBR_STATS
+	// ÿ̸߳ۼӣҪԭӲҲûα
+	// ߳̽ʱMergeThreadStatsϲȫ
+	extern thread_local long long threadStats[(int)Stat::Count];
+
+#define STAT_ADD(stat, n) (PBR::threadStats[(int)PBR::Stat::stat] += (n))
+#define STAT_INC(stat) STAT_ADD(stat, 1)
+
+	// ѵǰ̵߳ļϲȫֲ㣬Ⱦ߳깤
+	void MergeThreadStats();
+	// Ⱦڼļߡļ
+	// ÿȾʼʱãReportStatsֻͳһȾ
+	void ResetStats();
+	// ϲ̵߳ļ/롢ÿߵBVHڵβ
+	void ReportStats(double renderSeconds);
+#else
+#define STAT_ADD(stat, n) ((void)0)
+#define STAT_INC(stat) ((void)0)
+
+	inline void MergeThreadStats() {}
+	inline void ResetStats() {}
+	inline void ReportStats(double renderSeconds) {}
+#endif
+
+}
+
+#endif
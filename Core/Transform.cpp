@@ -1,4 +1,5 @@
 #include "Core\Transform.h"
+#include "Core\Interaction.h"
 #include <memory>
 
 static constexpr float Pi = 3.14159265358979323846;
@@ -251,6 +252,181 @@ namespace PBR
         return ret;
     }
 
+    SurfaceInteraction Transform::operator()(const SurfaceInteraction& si) const {
+        const Transform& t = *this;
+        SurfaceInteraction ret;
+        ret.p = t(si.p);
+        // 仿射变换的误差界：原误差经|M|放大，再加上本次计算的舍入误差
+        Vector3f absP(std::abs(si.p.x), std::abs(si.p.y), std::abs(si.p.z));
+        float e[3];
+        for (int i = 0; i < 3; ++i)
+            e[i] = (gamma(3) + 1) * (std::abs(m.m[i][0]) * si.pError.x +
+                std::abs(m.m[i][1]) * si.pError.y + std::abs(m.m[i][2]) * si.pError.z) +
+                gamma(3) * (std::abs(m.m[i][0]) * absP.x + std::abs(m.m[i][1]) * absP.y +
+                    std::abs(m.m[i][2]) * absP.z + std::abs(m.m[i][3]));
+        ret.pError = Vector3f(e[0], e[1], e[2]);
+        ret.n = Normalize(t(si.n));
+        ret.wo = t(si.wo);
+        if (ret.wo.LengthSquared() > 0) ret.wo = Normalize(ret.wo);
+        ret.time = si.time;
+        ret.mediumInterface = si.mediumInterface;
+        ret.uv = si.uv;
+        ret.shape = si.shape;
+        ret.dpdu = t(si.dpdu);
+        ret.dpdv = t(si.dpdv);
+        ret.dndu = t(si.dndu);
+        ret.dndv = t(si.dndv);
+        ret.shading.n = Normalize(t(si.shading.n));
+        ret.shading.dpdu = t(si.shading.dpdu);
+        ret.shading.dpdv = t(si.shading.dpdv);
+        ret.shading.dndu = t(si.shading.dndu);
+        ret.shading.dndv = t(si.shading.dndv);
+        ret.dudx = si.dudx;
+        ret.dvdx = si.dvdx;
+        ret.dudy = si.dudy;
+        ret.dvdy = si.dvdy;
+        ret.dpdx = t(si.dpdx);
+        ret.dpdy = t(si.dpdy);
+        ret.primitive = si.primitive;
+        ret.bsdf = si.bsdf;
+        ret.shading.n = Faceforward(ret.shading.n, ret.n);
+        return ret;
+    }
+
+    AnimatedTransform::AnimatedTransform(const Transform &startTransform, float startTime,
+                                         const Transform &endTransform, float endTime)
+        : startTransform(startTransform), endTransform(endTransform),
+          startTime(startTime), endTime(endTime),
+          actuallyAnimated(startTransform != endTransform)
+    {
+        Decompose(startTransform.GetMatrix(), &T[0], &R[0], &S[0]);
+        Decompose(endTransform.GetMatrix(), &T[1], &R[1], &S[1]);
+        // 四元数q与-q表示同一旋转，取夹角较小的一个使插值走最短弧
+        if (Dot(R[0], R[1]) < 0) R[1] = -R[1];
+        hasRotation = Dot(R[0], R[1]) < 0.9995f;
+    }
+
+    void AnimatedTransform::Decompose(const Matrix4x4 &m, Vector3f *T,
+                                      Quaternion *Rquat, Matrix4x4 *S)
+    {
+        // 平移
+        T->x = m.m[0][3];
+        T->y = m.m[1][3];
+        T->z = m.m[2][3];
+        Matrix4x4 M = m;
+        for (int i = 0; i < 3; ++i) M.m[i][3] = M.m[3][i] = 0.f;
+        M.m[3][3] = 1.f;
+
+        // 极分解：反复取R与其逆转置的平均，收敛到旋转部分
+        float norm;
+        int count = 0;
+        Matrix4x4 R = M;
+        do
+        {
+            Matrix4x4 Rnext;
+            Matrix4x4 Rit = Inverse(Transpose(R));
+            for (int i = 0; i < 4; ++i)
+                for (int j = 0; j < 4; ++j)
+                    Rnext.m[i][j] = 0.5f * (R.m[i][j] + Rit.m[i][j]);
+            norm = 0;
+            for (int i = 0; i < 3; ++i)
+            {
+                float n = std::abs(R.m[i][0] - Rnext.m[i][0]) +
+                          std::abs(R.m[i][1] - Rnext.m[i][1]) +
+                          std::abs(R.m[i][2] - Rnext.m[i][2]);
+                norm = std::max(norm, n);
+            }
+            R = Rnext;
+        } while (++count < 100 && norm > .0001f);
+        *Rquat = Quaternion(Transform(R));
+        // 缩放 = R^-1 * M
+        *S = Matrix4x4::Mul(Inverse(R), M);
+    }
+
+    void AnimatedTransform::Interpolate(float time, Transform *t) const
+    {
+        if (!actuallyAnimated || time <= startTime)
+        {
+            *t = startTransform;
+            return;
+        }
+        if (time >= endTime)
+        {
+            *t = endTransform;
+            return;
+        }
+        float dt = (time - startTime) / (endTime - startTime);
+        Vector3f trans = (1 - dt) * T[0] + dt * T[1];
+        Quaternion rotate = Slerp(dt, R[0], R[1]);
+        Matrix4x4 scale;
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                scale.m[i][j] = Lerp(dt, S[0].m[i][j], S[1].m[i][j]);
+        *t = Translate(trans) * rotate.ToTransform() * Transform(scale);
+    }
+
+    Ray AnimatedTransform::operator()(const Ray &r) const
+    {
+        if (!actuallyAnimated || r.time <= startTime)
+            return startTransform(r);
+        if (r.time >= endTime)
+            return endTransform(r);
+        Transform t;
+        Interpolate(r.time, &t);
+        return t(r);
+    }
+
+    Point3f AnimatedTransform::operator()(float time, const Point3f &p) const
+    {
+        if (!actuallyAnimated || time <= startTime) return startTransform(p);
+        if (time >= endTime) return endTransform(p);
+        Transform t;
+        Interpolate(time, &t);
+        return t(p);
+    }
+
+    Vector3f AnimatedTransform::operator()(float time, const Vector3f &v) const
+    {
+        if (!actuallyAnimated || time <= startTime) return startTransform(v);
+        if (time >= endTime) return endTransform(v);
+        Transform t;
+        Interpolate(time, &t);
+        return t(v);
+    }
+
+    Bounds3f AnimatedTransform::MotionBounds(const Bounds3f &b) const
+    {
+        if (!actuallyAnimated) return startTransform(b);
+        // 没有旋转时角点随时间线性运动，两端包围盒的并集即是精确范围
+        if (!hasRotation) return Union(startTransform(b), endTransform(b));
+
+        // 有旋转时在时间上均匀取样，并把每个样本的包围盒扩大到
+        // 半个步长内任意点可能移动的最大距离，保证结果是保守的：
+        // 点的速度不超过 |dT| + |dS * c| + theta * |S * c|（theta为总旋转角）
+        const int nSteps = 32;
+        float theta = 2 * std::acos(Clamp(Dot(R[0], R[1]), -1, 1));
+        float maxRadius = 0, maxScaleDelta = 0;
+        for (int c = 0; c < 8; ++c)
+        {
+            Vector3f corner(b.Corner(c));
+            for (int k = 0; k < 2; ++k)
+                maxRadius = std::max(maxRadius, Transform(S[k])(corner).Length());
+            Vector3f d = Transform(S[1])(corner) - Transform(S[0])(corner);
+            maxScaleDelta = std::max(maxScaleDelta, d.Length());
+        }
+        float speed = (T[1] - T[0]).Length() + maxScaleDelta + theta * maxRadius;
+        float pad = 0.5f * speed / (nSteps - 1);
+
+        Bounds3f bounds;
+        for (int i = 0; i < nSteps; ++i)
+        {
+            Transform t;
+            Interpolate(Lerp(float(i) / (nSteps - 1), startTime, endTime), &t);
+            bounds = Union(bounds, t(b));
+        }
+        return Expand(bounds, pad);
+    }
+
     Transform Orthographic(float zNear, float zFar) {
         return Scale(1, 1, 1 / (zFar - zNear)) * Translate(Vector3f(0, 0, -zNear));
     }
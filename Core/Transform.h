@@ -4,6 +4,7 @@
 
 #include "Core\Geometry.h"
 #include "Core\PBR.h"
+#include "Core\Quaternion.h"
 
 namespace PBR
 {
@@ -116,6 +117,8 @@ namespace PBR
         Bounds3f operator()(const Bounds3f& b) const;
         inline Ray operator()(const Ray& r) const;
         inline RayDifferential operator()(const RayDifferential& r) const;
+        // 任ļɫϢpError任Ŵ
+        SurfaceInteraction operator()(const SurfaceInteraction& si) const;
         Transform operator*(const Transform& t2) const;
         bool SwapsHandedness() const;
 
@@ -123,6 +126,34 @@ namespace PBR
         // Transform Private Data
         Matrix4x4 m, mInv;
     };
+    // ؼ֮֡Ķ任ֽΪƽTתRԪS
+    // ֱԲֵֵԲֵмʱ̵ı任Ϊ T * R * S
+    class AnimatedTransform
+    {
+    public:
+        AnimatedTransform(const Transform &startTransform, float startTime,
+                          const Transform &endTransform, float endTime);
+        static void Decompose(const Matrix4x4 &m, Vector3f *T, Quaternion *R,
+                              Matrix4x4 *S);
+        // ʱtimeı任timeڹؼ֮֡ʱȡ˵
+        void Interpolate(float time, Transform *t) const;
+        Ray operator()(const Ray &r) const;
+        Point3f operator()(float time, const Point3f &p) const;
+        Vector3f operator()(float time, const Vector3f &v) const;
+        bool IsAnimated() const { return actuallyAnimated; }
+        const Transform &StartTransform() const { return startTransform; }
+        // Χb˶ɨķΧ
+        Bounds3f MotionBounds(const Bounds3f &b) const;
+
+    private:
+        Transform startTransform, endTransform;
+        float startTime, endTime;
+        bool actuallyAnimated, hasRotation;
+        Vector3f T[2];
+        Quaternion R[2];
+        Matrix4x4 S[2];
+    };
+
     Transform Translate(const Vector3f &delta);
     Transform Scale(float x, float y, float z);
     Transform RotateX(float theta);
@@ -166,12 +197,12 @@ namespace PBR
         Point3f o = (*this)(r.o);
         Vector3f d = (*this)(r.d);
         float tMax = r.tMax;
-        return Ray(o, d, tMax, r.time);
+        return Ray(o, d, tMax, r.time, r.medium);
     }
 
     inline RayDifferential Transform::operator()(const RayDifferential& r) const {
         Ray tr = (*this)(Ray(r));
-        RayDifferential ret(tr.o, tr.d, tr.tMax, tr.time);
+        RayDifferential ret(tr);
         ret.hasDifferentials = r.hasDifferentials;
         ret.rxOrigin = (*this)(r.rxOrigin);
         ret.ryOrigin = (*this)(r.ryOrigin);
@@ -0,0 +1,69 @@
+#include "Integrator\Checkpoint.h"
+#include "Core\MappedFile.h"
+#include <cstring>
+#include <iostream>
+
+namespace PBR {
+
+	struct CheckpointHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t reserved;
+		CheckpointConfig config;
+		CheckpointProgress progress;
+	};
+
+	static const char CheckpointMagic[8] = { 'P', 'B', 'R', 'C', 'K', 'P', 'T', 0 };
+	// ļʽ˳仯ʱӰ汾ţɶϵԶʧЧ
+	static const uint32_t CheckpointVersion = 2;
+
+	bool WriteCheckpoint(const std::string& filename, const CheckpointConfig& config,
+		const CheckpointProgress& progress, const float* film, size_t filmFloats,
+		const void* pixelStats, size_t pixelStatsBytes) {
+		CheckpointHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, CheckpointMagic, sizeof(CheckpointMagic));
+		header.version = CheckpointVersion;
+		header.config = config;
+		header.progress = progress;
+
+		AtomicFileWriter f(filename);
+		f.Write(&header, sizeof(header));
+		f.Write(film, filmFloats * sizeof(float));
+		if (pixelStatsBytes > 0) f.Write(pixelStats, pixelStatsBytes);
+		return f.Commit();
+	}
+
+	bool ReadCheckpoint(const std::string& filename, const CheckpointConfig& config,
+		CheckpointProgress* progress, float* film, size_t filmFloats,
+		void* pixelStats, size_t pixelStatsBytes) {
+		MappedFile f;
+		if (!f.Open(filename)) return false;
+		if (f.Size() < sizeof(CheckpointHeader)) return false;
+		CheckpointHeader header;
+		memcpy(&header, f.Data(), sizeof(header));
+		if (memcmp(header.magic, CheckpointMagic, sizeof(CheckpointMagic)) != 0 ||
+			header.version != CheckpointVersion)
+			return false;
+		if (header.config.fingerprint != config.fingerprint) {
+			std::cerr << "Checkpoint " << filename
+				<< " was written for a different scene, camera or integrator, ignored" << std::endl;
+			return false;
+		}
+		// ֶαȽϣ߶memsetٸֵģֽҲһ
+		if (memcmp(&header.config, &config, sizeof(config)) != 0) {
+			std::cerr << "Checkpoint " << filename
+				<< " was written with different render settings, ignored" << std::endl;
+			return false;
+		}
+		size_t filmBytes = filmFloats * sizeof(float);
+		if (f.Size() != sizeof(header) + filmBytes + pixelStatsBytes) return false;
+
+		*progress = header.progress;
+		memcpy(film, f.Data() + sizeof(header), filmBytes);
+		if (pixelStatsBytes > 0)
+			memcpy(pixelStats, f.Data() + sizeof(header) + filmBytes, pixelStatsBytes);
+		return true;
+	}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef __Checkpoint_h__
+#define __Checkpoint_h__
+
+#include "Core\PBR.h"
+#include "Core\Geometry.h"
+#include <string>
+
+namespace PBR {
+
+	// ϵӦȾãָʱ뵱ǰȫһ£ϵ
+	struct CheckpointConfig {
+		int32_t x0, y0, x1, y1;  // pixelBounds
+		int32_t filmWidth, filmHeight;
+		int64_t samplesPerPixel;
+		int32_t sppPerPass;
+		int32_t adaptive;
+		float targetError;
+		int32_t minSamples;
+		float sampleBudget;
+		int32_t pixelStatsSize;  // Ӧʱÿͳֽ
+		uint64_t fingerprint;    // ָƣSamplerIntegrator::SetSceneFingerprint
+	};
+
+	// ϵ¼Ⱦ
+	struct CheckpointProgress {
+		int32_t passesDone;
+		// ӦӦĳʼ׶еӦ֮ͳ
+		int32_t sampleStart;
+		int64_t samplesDone;
+		// ֮ǰۼƵȾʱ䣨룩
+		double renderTime;
+	};
+
+	// ϵļļͷ | ƬۼӻÿRGBȨȨغͣ| ͳƣӦ
+	// дԭӵģдʱļ滻Ⱦκʱֹ̱²Ķϵ
+	bool WriteCheckpoint(const std::string& filename, const CheckpointConfig& config,
+		const CheckpointProgress& progress, const float* film, size_t filmFloats,
+		const void* pixelStats, size_t pixelStatsBytes);
+
+	// ȡϵ㣺ļڡʽconfigһʱfalse
+	// ֻзtrueʱfilmpixelStatsŻᱻ
+	bool ReadCheckpoint(const std::string& filename, const CheckpointConfig& config,
+		CheckpointProgress* progress, float* film, size_t filmFloats,
+		void* pixelStats, size_t pixelStatsBytes);
+
+}
+
+#endif
@@ -2,8 +2,14 @@
 #include "Core\Scene.h"
 #include "Sampler\Sampler.h"
 #include "Light\Light.h"
+#include "Core\MappedFile.h"
 
 namespace PBR {
+	uint64_t DirectLightingIntegrator::ParameterHash() const {
+		uint64_t h = HashBytes(&strategy, sizeof(strategy));
+		return HashBytes(&maxDepth, sizeof(maxDepth), h);
+	}
+
 	// ԤΪ UniformSampleAll ò
 	void DirectLightingIntegrator::Preprocess(const Scene& scene,
 		Sampler& sampler) {
@@ -26,7 +32,7 @@ namespace PBR {
 	}
 
 	Spectrum DirectLightingIntegrator::Li(const RayDifferential& ray,
-		const Scene& scene, Sampler& sampler, int depth) const {
+		const Scene& scene, Sampler& sampler, MemoryArena& arena, int depth) const {
 		// Whittedͬ
 		Spectrum L(0.f);
 		SurfaceInteraction isect;
@@ -34,9 +40,9 @@ namespace PBR {
 			for (const auto& light : scene.lights) L += light->Le(ray);
 			return L;
 		}
-		isect.ComputeScatteringFunctions(ray);
+		isect.ComputeScatteringFunctions(ray, arena);
 		if (!isect.bsdf)
-			return Li(isect.SpawnRay(ray.d), scene, sampler, depth);
+			return Li(isect.SpawnRay(ray.d), scene, sampler, arena, depth);
 		Vector3f wo = isect.wo;
 		L += isect.Le(wo);
 
@@ -52,8 +58,8 @@ namespace PBR {
 		// ҲWhittedͬ
 		if (depth + 1 < maxDepth) {
 			// Trace rays for specular reflection and refraction
-			L += SpecularReflect(ray, isect, scene, sampler, depth);
-			//L += SpecularTransmit(ray, isect, scene, sampler, depth);
+			L += SpecularReflect(ray, isect, scene, sampler, arena, depth);
+			//L += SpecularTransmit(ray, isect, scene, sampler, arena, depth);
 		}
 		return L;
 	}
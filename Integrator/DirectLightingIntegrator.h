@@ -25,11 +25,13 @@ namespace PBR {
             maxDepth(maxDepth) {}
         // 䣬 ray Ĺ⣨Spectrum
         Spectrum Li(const RayDifferential& ray, const Scene& scene,
-            Sampler& sampler, int depth) const;
+            Sampler& sampler, MemoryArena& arena, int depth) const;
         // Ԥ
         void Preprocess(const Scene& scene, Sampler& sampler);
 
     private:
+        uint64_t ParameterHash() const;
+
         const LightStrategy strategy;
         const int maxDepth;
         // nLightSamples[i] 洢˳е i ԴҪĴ
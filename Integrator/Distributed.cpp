@@ -0,0 +1,275 @@
+#include "Integrator\Distributed.h"
+#include <algorithm>
+#include <cstring>
+#if defined(_WIN32)
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+typedef SOCKET SocketHandle;
+typedef int SocketLength;
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <spawn.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+typedef int SocketHandle;
+typedef socklen_t SocketLength;
+#endif
+
+namespace PBR {
+
+	struct MessageHeader {
+		uint32_t type;
+		uint32_t size;
+	};
+
+	// WinsockҪȳʼһ
+	static bool initSockets() {
+#if defined(_WIN32)
+		static bool initialized = [] {
+			WSADATA data;
+			return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+		}();
+		return initialized;
+#else
+		return true;
+#endif
+	}
+
+	static void closeSocket(intptr_t handle) {
+#if defined(_WIN32)
+		closesocket((SocketHandle)handle);
+#else
+		close((SocketHandle)handle);
+#endif
+	}
+
+	// ϢСرNagle㷨ӳȷϵӳʮͣ
+	static void setNoDelay(intptr_t handle) {
+		int flag = 1;
+		setsockopt((SocketHandle)handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&flag, sizeof(flag));
+	}
+
+	static bool resolve(const std::string& host, int port, sockaddr_in* addr) {
+		memset(addr, 0, sizeof(*addr));
+		addr->sin_family = AF_INET;
+		addr->sin_port = htons((unsigned short)port);
+		if (inet_pton(AF_INET, host.c_str(), &addr->sin_addr) == 1) return true;
+		addrinfo hints, *result = nullptr;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) return false;
+		addr->sin_addr = ((sockaddr_in*)result->ai_addr)->sin_addr;
+		freeaddrinfo(result);
+		return true;
+	}
+
+	bool Connection::Connect(const std::string& host, int port) {
+		Close();
+		sockaddr_in addr;
+		if (!initSockets() || !resolve(host, port, &addr)) return false;
+		SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if ((intptr_t)s == InvalidHandle) return false;
+		if (connect(s, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+			closeSocket((intptr_t)s);
+			return false;
+		}
+		handle = (intptr_t)s;
+		setNoDelay(handle);
+		return true;
+	}
+
+	bool Connection::sendAll(const char* data, size_t size) {
+		while (size > 0) {
+			int chunk = (int)std::min(size, (size_t)1 << 30);
+#if defined(_WIN32)
+			int sent = send((SocketHandle)handle, data, chunk, 0);
+#elif defined(MSG_NOSIGNAL)
+			// ԷѶϿʱҪSIGPIPẸǷش
+			int sent = (int)send((SocketHandle)handle, data, chunk, MSG_NOSIGNAL);
+#else
+			int sent = (int)send((SocketHandle)handle, data, chunk, 0);
+#endif
+			if (sent <= 0) return false;
+			data += sent;
+			size -= sent;
+		}
+		return true;
+	}
+
+	bool Connection::receiveAll(char* data, size_t size) {
+		while (size > 0) {
+			int chunk = (int)std::min(size, (size_t)1 << 30);
+			int received = (int)recv((SocketHandle)handle, data, chunk, 0);
+			if (received <= 0) return false;
+			data += received;
+			size -= received;
+		}
+		return true;
+	}
+
+	bool Connection::Send(MessageType type, const void* data, size_t size) {
+		if (!IsOpen()) return false;
+		MessageHeader header = { (uint32_t)type, (uint32_t)size };
+		if (!sendAll((const char*)&header, sizeof(header)) || !sendAll((const char*)data, size)) {
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	bool Connection::Receive(MessageType* type, std::vector<char>* payload) {
+		if (!IsOpen()) return false;
+		MessageHeader header;
+		if (!receiveAll((char*)&header, sizeof(header))) {
+			Close();
+			return false;
+		}
+		if (header.type < (uint32_t)MessageType::Hello || header.type > (uint32_t)MessageType::Done ||
+			header.size > maxPayload[header.type]) {
+			Close();
+			return false;
+		}
+		payload->resize(header.size);
+		if (header.size > 0 && !receiveAll(payload->data(), header.size)) {
+			Close();
+			return false;
+		}
+		*type = (MessageType)header.type;
+		return true;
+	}
+
+	void Connection::Close() {
+		if (!IsOpen()) return;
+		closeSocket(handle);
+		handle = InvalidHandle;
+	}
+
+	int Listener::Listen(const std::string& host, int port) {
+		Close();
+		sockaddr_in addr;
+		if (!initSockets() || !resolve(host, port, &addr)) return -1;
+		SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if ((intptr_t)s == -1) return -1;
+		int reuse = 1;
+		setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+		SocketLength length = sizeof(addr);
+		if (bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 64) != 0 ||
+			getsockname(s, (sockaddr*)&addr, &length) != 0) {
+			closeSocket((intptr_t)s);
+			return -1;
+		}
+		handle = (intptr_t)s;
+		return ntohs(addr.sin_port);
+	}
+
+	bool Listener::Wait(const std::vector<Connection*>& connections, double timeout,
+		bool* acceptable, std::vector<int>* readable) {
+		*acceptable = false;
+		readable->clear();
+		fd_set set;
+		FD_ZERO(&set);
+		SocketHandle maxHandle = 0;
+		if (handle != -1) {
+			FD_SET((SocketHandle)handle, &set);
+			maxHandle = (SocketHandle)handle;
+		}
+		for (Connection* c : connections) {
+			if (!c->IsOpen()) continue;
+			FD_SET((SocketHandle)c->handle, &set);
+			maxHandle = std::max(maxHandle, (SocketHandle)c->handle);
+		}
+		timeval tv;
+		tv.tv_sec = (long)timeout;
+		tv.tv_usec = (long)((timeout - (long)timeout) * 1e6);
+		// WindowsselectԵһ
+		int n = select((int)maxHandle + 1, &set, nullptr, nullptr, &tv);
+		if (n < 0) return false;
+		if (n == 0) return true;
+		if (handle != -1 && FD_ISSET((SocketHandle)handle, &set)) *acceptable = true;
+		for (int i = 0; i < (int)connections.size(); ++i)
+			if (connections[i]->IsOpen() && FD_ISSET((SocketHandle)connections[i]->handle, &set))
+				readable->push_back(i);
+		return true;
+	}
+
+	std::unique_ptr<Connection> Listener::Accept() {
+		SocketHandle s = accept((SocketHandle)handle, nullptr, nullptr);
+		if ((intptr_t)s == -1) return nullptr;
+		std::unique_ptr<Connection> connection(new Connection);
+		connection->handle = (intptr_t)s;
+		setNoDelay(connection->handle);
+		return connection;
+	}
+
+	void Listener::Close() {
+		if (handle == -1) return;
+		closeSocket(handle);
+		handle = -1;
+	}
+
+	std::string CurrentExecutable() {
+#if defined(_WIN32)
+		char path[4096];
+		DWORD length = GetModuleFileNameA(nullptr, path, sizeof(path));
+		if (length == 0 || length >= sizeof(path)) return "";
+		return std::string(path, length);
+#elif defined(__linux__)
+		char path[4096];
+		ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+		if (length <= 0 || length >= (ssize_t)sizeof(path)) return "";
+		return std::string(path, length);
+#else
+		return "";
+#endif
+	}
+
+	intptr_t SpawnProcess(const std::string& exe, const std::vector<std::string>& args) {
+#if defined(_WIN32)
+		// ƴУ
+		std::string commandLine = "\"" + exe + "\"";
+		for (const std::string& arg : args) commandLine += " \"" + arg + "\"";
+		STARTUPINFOA startup;
+		memset(&startup, 0, sizeof(startup));
+		startup.cb = sizeof(startup);
+		PROCESS_INFORMATION info;
+		// CreateProcessеĵһңposix_spawnpһPATH
+		if (!CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, FALSE, 0,
+			nullptr, nullptr, &startup, &info))
+			return 0;
+		CloseHandle(info.hThread);
+		return (intptr_t)info.hProcess;
+#else
+		std::vector<char*> argv;
+		argv.push_back(const_cast<char*>(exe.c_str()));
+		for (const std::string& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+		argv.push_back(nullptr);
+		pid_t pid;
+		if (posix_spawnp(&pid, exe.c_str(), nullptr, nullptr, argv.data(), environ) != 0) return 0;
+		return (intptr_t)pid;
+#endif
+	}
+
+	int WaitProcess(intptr_t process) {
+#if defined(_WIN32)
+		WaitForSingleObject((HANDLE)process, INFINITE);
+		DWORD code = 0;
+		GetExitCodeProcess((HANDLE)process, &code);
+		CloseHandle((HANDLE)process);
+		return (int)code;
+#else
+		int status = 0;
+		if (waitpid((pid_t)process, &status, 0) < 0) return -1;
+		return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+	}
+
+}
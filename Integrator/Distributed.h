@@ -0,0 +1,97 @@
+#pragma once
+#ifndef __Distributed_h__
+#define __Distributed_h__
+
+#include "Core\PBR.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PBR {
+
+	// ֲʽȾϢ͡ÿϢΪ8ֽڵϢͷֽ͡Ӹأ
+	// ذֱֽӴ䣬Э빤ҪֽͬĻ
+	enum class MessageType : uint32_t {
+		Hello = 1,  //  -> ЭߣWorkerHelloӺһ
+		Task,       // Э -> ̣RenderTask
+		Result,     //  -> ЭߣRenderTask + ƬصRGBƽֵ4float
+		Done        // Э -> ̣ûˣ˳
+	};
+
+	// Э汾Ϣʽ仯ʱ
+	static const uint32_t DistributedProtocolVersion = 2;
+
+	// ̵ȾãЭ߾ݴȷ˫Ⱦͬһͼ
+	struct WorkerHello {
+		uint32_t version;
+		int32_t x0, y0, x1, y1;  // pixelBounds
+		int64_t samplesPerPixel;
+		uint64_t fingerprint;  // ָƣSamplerIntegrator::SetSceneFingerprint
+	};
+
+	// һƬ[x0, x1)  [y0, y1)[sampleStart, sampleEnd)Χ
+	struct RenderTask {
+		int32_t id;
+		int32_t x0, y0, x1, y1;
+		int32_t sampleStart, sampleEnd;
+	};
+
+	// ʽTCPӣϢշ
+	class Connection {
+	public:
+		Connection() {}
+		~Connection() { Close(); }
+		Connection(const Connection&) = delete;
+		Connection& operator=(const Connection&) = delete;
+
+		bool Connect(const std::string& host, int port);
+		bool Send(MessageType type, const void* data, size_t size);
+		// ĳϢصֽû޵Ϣֻܲ
+		void SetMaxPayload(MessageType type, size_t size) { maxPayload[(int)type] = size; }
+		// һϢӶϿϢδ֪سʱرӲfalse
+		bool Receive(MessageType* type, std::vector<char>* payload);
+		void Close();
+		bool IsOpen() const { return handle != InvalidHandle; }
+
+	private:
+		friend class Listener;
+		static const intptr_t InvalidHandle = -1;
+		bool sendAll(const char* data, size_t size);
+		bool receiveAll(char* data, size_t size);
+
+		intptr_t handle = InvalidHandle;
+		// MessageType±ĸޣԷĳȼٷ
+		size_t maxPayload[(int)MessageType::Done + 1] = {};
+	};
+
+	// ˿ڣ̵ܹ
+	class Listener {
+	public:
+		Listener() {}
+		~Listener() { Close(); }
+		Listener(const Listener&) = delete;
+		Listener& operator=(const Listener&) = delete;
+
+		// host:portϼportΪ0ʱϵͳж˿ڣʵʶ˿ڣʧܷ-1
+		int Listen(const std::string& host, int port);
+		// ȴtimeout룬ֱӣ*acceptableΪtrueĳЩӿɶ±дreadable
+		bool Wait(const std::vector<Connection*>& connections, double timeout,
+			bool* acceptable, std::vector<int>* readable);
+		std::unique_ptr<Connection> Accept();
+		void Close();
+
+	private:
+		intptr_t handle = -1;
+	};
+
+	// ǰִ̿ļ·ȡʱؿַ
+	// PATHʱargv[0]ֻļҪ·
+	std::string CurrentExecutable();
+	// ӽ̣Ϊexeargsؽ̾ʧܷ0exe·ʱPATHв
+	intptr_t SpawnProcess(const std::string& exe, const std::vector<std::string>& args);
+	// ȴӽ̽˳
+	int WaitProcess(intptr_t process);
+
+}
+
+#endif
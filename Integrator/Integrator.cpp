@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Integrator\Integrator.h"
+#include "Integrator\Checkpoint.h"
+#include "Integrator\Distributed.h"
 #include "Sampler\Sampler.h"
 #include "Core\Spectrum.h"
 #include "Core\interaction.h"
@@ -9,8 +11,19 @@
 #include "Material\Reflection.h"
 #include "Light\Light.h"
 #include "Sampler/Sampling.h"
+#include "Core\Stats.h"
+#include "Core\MappedFile.h"
+#include "Camera\Camera.h"
 #include <omp.h>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <typeinfo>
 
 namespace PBR{
 
@@ -178,7 +191,7 @@ namespace PBR{
 
     Spectrum SamplerIntegrator::SpecularReflect(
         const RayDifferential& ray, const SurfaceInteraction& isect,
-        const Scene& scene, Sampler& sampler, int depth) const
+        const Scene& scene, Sampler& sampler, MemoryArena& arena, int depth) const
     {
         // 㷴䷽ɫ
         Vector3f wo = isect.wo, wi;
@@ -215,7 +228,7 @@ namespace PBR{
                 rd.ryDirection =
                     wi - dwody + 2.f * Vector3f(Dot(wo, ns) * dndy + dDNdy * ns);
             }
-            return f * Li(rd, scene, sampler, depth + 1) * AbsDot(wi, ns) / pdf;
+            return f * Li(rd, scene, sampler, arena, depth + 1) * AbsDot(wi, ns) / pdf;
         }
         else
             return Spectrum(0.f);
@@ -223,7 +236,7 @@ namespace PBR{
 
     Spectrum SamplerIntegrator::SpecularTransmit(
         const RayDifferential& ray, const SurfaceInteraction& isect,
-        const Scene& scene, Sampler& sampler, int depth) const
+        const Scene& scene, Sampler& sampler, MemoryArena& arena, int depth) const
     {
         // ䷽
         Vector3f wo = isect.wo, wi;
@@ -272,91 +285,651 @@ namespace PBR{
                 rd.ryDirection =
                     wi - eta * dwody + Vector3f(mu * dndy + dmudy * ns);
             }
-            L = f * Li(rd, scene, sampler, depth + 1) * AbsDot(wi, ns) / pdf;
+            L = f * Li(rd, scene, sampler, arena, depth + 1) * AbsDot(wi, ns) / pdf;
         }
         return L;
     }
 
 	void SamplerIntegrator::Render(const Scene& scene, double& timeConsume) {
-        //̵߳ĸ
-		omp_set_num_threads(4); 
+        //߳ĬȡӲ߳
+        int nRenderThreads = nThreads > 0 ? nThreads : (int)std::thread::hardware_concurrency();
+        if (nRenderThreads <= 0) nRenderThreads = omp_get_num_procs();
         //ȡʼʱ 
 		double start = omp_get_wtime();
+        // ͳֻԱȾȾ֡ʱÿ֡Ĺ/ȷ
+        ResetStats();
         Preprocess(scene, *sampler);
 
-#pragma omp parallel for
-        for (int j = 0; j < pixelBounds.pMax.x; j++) {
-            for (int i = 0; i < pixelBounds.pMax.y; i++) {
-                // Ϊǰشһ
-                int offset = (pixelBounds.pMax.x * j + i);
-                std::unique_ptr<Sampler> pixelSampler = sampler->Clone(offset);
-                Point2i pixel(i, j);
-                pixelSampler->StartPixel(pixel);
-                // ʼɫΪɫ
-                Spectrum colObj(0.0f);             
-                // ʼԵؽжβ
-                do {
-                    // Ӳȡ
-                    CameraSample cameraSample = pixelSampler->GetCameraSample(pixel);
-                    // һ
-                    RayDifferential r;
-                    float rayWeight =
-                        camera->GenerateRayDifferential(cameraSample, &r);
-                    r.ScaleDifferentials(
-                        1 / std::sqrt((float)pixelSampler->samplesPerPixel));
-
-                    //ʵֵ Li() ɫ
-                    colObj += Li(r, scene, *pixelSampler, 0);                   
-                } while (pixelSampler->StartNextSample()); // ƶǰصһ
-
-                // Ľȡƽֵ
-                colObj /= (float)pixelSampler->samplesPerPixel;
-
-                /*colObj = PBR::RGBSpectrum::HDRtoLDR(colObj, 0.25f);
-
-                float r = PBR::Clamp(colObj[0], 0.0f, 1.0f);
-                float g = PBR::Clamp(colObj[1], 0.0f, 1.0f);
-                float b = PBR::Clamp(colObj[2], 0.0f, 1.0f);
-
-
-                // ռƽɫµ֡
-                m_FrameBuffer->set_uc(i, pixelBounds.pMax.y - j - 1, 0, (unsigned char)(colObj[0] * 255.999f));
-                m_FrameBuffer->set_uc(i, pixelBounds.pMax.y - j - 1, 1, (unsigned char)(colObj[1] * 255.999f));
-                m_FrameBuffer->set_uc(i, pixelBounds.pMax.y - j - 1, 2, (unsigned char)(colObj[2] * 255.999f));
-                m_FrameBuffer->set_uc(i, pixelBounds.pMax.y - j - 1, 3, 255);*/
-                float xyz[3];
-                colObj.ToXYZ(xyz); // <-- ⽫ RGBSpectrum::ToXYZ
-
-                // 2.  XYZ ת sRGB ɫʿռ
-                float rgb[3];
-                XYZToRGB(xyz, rgb); // <-- ⽫ȫ XYZToRGB
-
-                // 3. ִ Gamma  8-bit ת
-                //    ( PBR::Clamp ڱ𴦶)
-                unsigned char r_byte = (unsigned char)PBR::Clamp(255.f * GammaCorrect(rgb[0]) + 0.5f, 0.f, 255.f);
-                unsigned char g_byte = (unsigned char)PBR::Clamp(255.f * GammaCorrect(rgb[1]) + 0.5f, 0.f, 255.f);
-                unsigned char b_byte = (unsigned char)PBR::Clamp(255.f * GammaCorrect(rgb[2]) + 0.5f, 0.f, 255.f);
-
-                // 4. ռƽɫµ֡
-                m_FrameBuffer->set_uc(i, pixelBounds.pMax.y - j - 1, 0, r_byte);
-                m_FrameBuffer->set_uc(i, pixelBounds.pMax.y - j - 1, 1, g_byte);
-                m_FrameBuffer->set_uc(i, pixelBounds.pMax.y - j - 1, 2, b_byte);
-                m_FrameBuffer->set_uc(i, pixelBounds.pMax.y - j - 1, 3, 255); // Alpha
+        // Ƭͼ߳ԼƬȡ̵߳
+        TileScheduler scheduler(pixelBounds, tileSize, tileOrder, nRenderThreads);
+        int nTiles = scheduler.TileCount();
+        std::vector<double> tileTime(nTiles, 0.0);
+        std::vector<int> tileThread(nTiles, 0);
+        std::vector<double> threadBusy(nRenderThreads, 0.0);
+
+        // ʽȾÿһ[sampleStart, sampleEnd)ΧۼӵHDRƬ
+        int spp = (int)sampler->samplesPerPixel;
+        int passSpp = sppPerPass > 0 ? std::min(sppPerPass, spp) : spp;
+        int nPasses = (spp + passSpp - 1) / passSpp;
+        m_FrameBuffer->ClearAccumulation();
+        samplesTaken = 0;
+        int passesDone = 0;
+        int imageWidth = pixelBounds.pMax.x - pixelBounds.pMin.x;
+        int nPixels = pixelBounds.Area();
+        int64_t samplesDone = 0;
+        // ʱԤδָÿʱٱ֮ÿԼռԤ1/8
+        bool autoPassSize = timeBudget > 0 && sppPerPass <= 0;
+        // ܱ֪ʱȫʾ
+        bool knownPasses = timeBudget <= 0;
+        double lastPassTime = 0;
+        int64_t lastPassSamples = 0;
+
+        // ӦضɹminSamples֮ÿһֵֻأ
+        // ÿشԼеֱûҪػԤ
+        bool adaptive = targetError > 0;
+        if (adaptive) {
+            if (sppPerPass <= 0) passSpp = std::min(minSamples, spp);
+            autoPassSize = false;
+            knownPasses = false;
+            pixelStats.assign(nPixels, PixelStats());
+            pixelError.assign(nPixels, 0.f);
+        }
+
+        // ӦӦĳʼ׶ΣͬƽsampleStartΪе
+        int sampleStart = 0;
+
+        // ϵ֣ϵе뵱ǰһʱָƬͳ
+        CheckpointConfig checkpointConfig;
+        memset(&checkpointConfig, 0, sizeof(checkpointConfig));
+        checkpointConfig.x0 = pixelBounds.pMin.x;
+        checkpointConfig.y0 = pixelBounds.pMin.y;
+        checkpointConfig.x1 = pixelBounds.pMax.x;
+        checkpointConfig.y1 = pixelBounds.pMax.y;
+        checkpointConfig.filmWidth = m_FrameBuffer->getWidth();
+        checkpointConfig.filmHeight = m_FrameBuffer->getHeight();
+        checkpointConfig.samplesPerPixel = spp;
+        checkpointConfig.sppPerPass = sppPerPass;
+        checkpointConfig.adaptive = adaptive ? 1 : 0;
+        if (adaptive) {
+            checkpointConfig.targetError = targetError;
+            checkpointConfig.minSamples = minSamples;
+            checkpointConfig.sampleBudget = sampleBudget;
+            checkpointConfig.pixelStatsSize = sizeof(PixelStats);
+        }
+        checkpointConfig.fingerprint = renderFingerprint(scene);
+        size_t filmFloats = (size_t)checkpointConfig.filmWidth * checkpointConfig.filmHeight * 4;
+        size_t pixelStatsBytes = pixelStats.size() * sizeof(PixelStats);
+        double previousTime = 0;
+        if (!checkpointFile.empty()) {
+            CheckpointProgress progress;
+            if (ReadCheckpoint(checkpointFile, checkpointConfig, &progress,
+                m_FrameBuffer->getAccumBuffer(), filmFloats, pixelStats.data(), pixelStatsBytes)) {
+                passesDone = progress.passesDone;
+                sampleStart = progress.sampleStart;
+                samplesDone = progress.samplesDone;
+                previousTime = progress.renderTime;
+                samplesTaken = (float)((double)samplesDone / nPixels);
+                std::cout << "Resumed from checkpoint " << checkpointFile << ": " << passesDone
+                    << " passes, " << std::fixed << std::setprecision(2) << samplesTaken
+                    << " spp, " << previousTime << " s" << std::endl;
+            }
+        }
+        double lastCheckpoint = omp_get_wtime();
+        auto saveCheckpoint = [&]() {
+            CheckpointProgress progress;
+            memset(&progress, 0, sizeof(progress));
+            progress.passesDone = passesDone;
+            progress.sampleStart = sampleStart;
+            progress.samplesDone = samplesDone;
+            progress.renderTime = previousTime + (omp_get_wtime() - start);
+            if (!WriteCheckpoint(checkpointFile, checkpointConfig, progress,
+                m_FrameBuffer->getAccumBuffer(), filmFloats, pixelStats.data(), pixelStatsBytes))
+                std::cerr << std::endl << "Failed to write checkpoint " << checkpointFile << std::endl;
+            lastCheckpoint = omp_get_wtime();
+        };
+
+        int firstPass = passesDone;
+        for (int pass = firstPass; ; ++pass) {
+            bool refine = adaptive && sampleStart >= std::min(minSamples, spp);
+            if (!refine && sampleStart >= spp) break;
+
+            // ʱԤ㣺һÿƽʱʣʱڻܲɶ
+            int64_t maxPassSamples = -1;
+            if (timeBudget > 0 && lastPassSamples > 0) {
+                double remaining = timeBudget - (omp_get_wtime() - start);
+                double secondsPerSample = lastPassTime / std::max(lastPassSamples, (int64_t)1);
+                maxPassSamples = remaining > 0 ? (int64_t)(remaining / secondsPerSample) : 0;
             }
-            // һ
-            if (omp_get_thread_num() == 0) {
-                float progress = 100.0f * (j + 1) / pixelBounds.pMax.y;
-                std::cout << "\rRendering progress: " << std::fixed << std::setprecision(2) << progress << "%" << std::flush;
+            int passSize = passSpp;
+            float threshold = 0;
+            if (refine) {
+                if (!adaptiveThreshold(spp, passSpp, samplesDone,
+                    maxPassSamples >= 0 ? maxPassSamples / passSpp : -1, &threshold))
+                    break;
             }
+            else {
+                // ʱԤʱһÿֻ1٣򻹲֪ÿĺʱ
+                // sppPerPassɵĵһԶԶԤ
+                if (timeBudget > 0 && lastPassSamples == 0)
+                    passSize = 1;
+                else if (autoPassSize) {
+                    double secondsPerSpp = lastPassTime / std::max(lastPassSamples, (int64_t)1) * nPixels;
+                    passSize = std::max((int)(timeBudget / 8 / secondsPerSpp), 1);
+                }
+                // ʣʱÿ1ʱСһⳬԤ
+                if (maxPassSamples >= 0) {
+                    int64_t fit = maxPassSamples / std::max(nPixels, 1);
+                    if (fit < 1) break;
+                    passSize = (int)std::min((int64_t)passSize, fit);
+                }
+            }
+            int sampleEnd = std::min(sampleStart + passSize, spp);
+            double passStart = omp_get_wtime();
+            std::atomic<int> tilesDone(0);
+            std::atomic<int64_t> passSamples(0);
+            if (pass > firstPass) scheduler.Reset();
+
+#pragma omp parallel num_threads(nRenderThreads)
+            {
+                int threadIndex = omp_get_thread_num();
+                // ÿֻ߳¡һβStartPixelãѭвٷڴ
+                std::unique_ptr<Sampler> pixelSampler = sampler->Clone(0);
+                // ÿ߳һڴأɫõBSDF/BxDF
+                MemoryArena arena;
+                int tileIndex;
+                while (scheduler.Next(threadIndex, &tileIndex)) {
+                    double tileStart = omp_get_wtime();
+                    Bounds2i tileBounds = scheduler.TileBounds(tileIndex);
+                    int64_t tileSamples = 0;
+                    for (int y = tileBounds.pMin.y; y < tileBounds.pMax.y; ++y) {
+                        for (int x = tileBounds.pMin.x; x < tileBounds.pMax.x; ++x) {
+                            // һ鱾ҪɵΧӦʱ
+                            int pixelIndex = (y - pixelBounds.pMin.y) * imageWidth + (x - pixelBounds.pMin.x);
+                            int firstSample = sampleStart, lastSample = sampleEnd;
+                            if (adaptive) {
+                                if (refine && !(pixelError[pixelIndex] > threshold)) continue;
+                                firstSample = pixelStats[pixelIndex].n;
+                                lastSample = std::min(firstSample + passSize, spp);
+                                if (firstSample >= lastSample) continue;
+                            }
+                            float rgb[3];
+                            samplePixel(scene, *pixelSampler, arena, Point2i(x, y), firstSample, lastSample,
+                                rgb, adaptive ? &pixelStats[pixelIndex] : nullptr);
+                            // ΪȨۼӵƬעYᷭת
+                            m_FrameBuffer->AddSample(x, pixelBounds.pMax.y - y - 1,
+                                rgb, (float)(lastSample - firstSample));
+                            tileSamples += lastSample - firstSample;
+                        }
+                    }
+                    passSamples += tileSamples;
+                    // ¼Ƭʱ
+                    double tileEnd = omp_get_wtime();
+                    tileTime[tileIndex] += tileEnd - tileStart;
+                    tileThread[tileIndex] = threadIndex;
+                    threadBusy[threadIndex] += tileEnd - tileStart;
+                    int done = ++tilesDone;
+                    // һӦʱԤʱܱδֻ֪ʾǰһĽ
+                    if (threadIndex == 0) {
+                        float progress = knownPasses ? 100.0f * (pass * nTiles + done) / (nPasses * nTiles)
+                            : 100.0f * done / nTiles;
+                        std::cout << "\rRendering progress: ";
+                        if (!knownPasses) std::cout << "pass " << pass + 1 << " ";
+                        std::cout << std::fixed << std::setprecision(2) << progress << "%" << std::flush;
+                    }
+                }
+                // ϲ̵߳ͳƼ
+                MergeThreadStats();
+            }
+            samplesDone += passSamples;
+            if (!refine) sampleStart = sampleEnd;
+            lastPassTime = omp_get_wtime() - passStart;
+            lastPassSamples = passSamples;
+            samplesTaken = (float)((double)samplesDone / nPixels);
+            ++passesDone;
+
+            // ÿһƬͼ񣬿Ԥǰ
+            bool stop = passCallback && !passCallback((int)samplesTaken);
+            if (!previewFile.empty() && (stop || (pass + 1) % previewInterval == 0)) {
+                m_FrameBuffer->Resolve();
+                if (!m_FrameBuffer->WriteImage(previewFile.c_str()))
+                    std::cerr << std::endl << "Failed to write preview " << previewFile << std::endl;
+            }
+            if (stop) break;
+            if (!checkpointFile.empty() && omp_get_wtime() - lastCheckpoint >= checkpointInterval)
+                saveCheckpoint();
         }
+        // ʱҲдһζϵ㣺ǰȾ֮ԽȾɵȾٴʱֱӵõ
+        if (!checkpointFile.empty()) saveCheckpoint();
+        m_FrameBuffer->Resolve();
 
 		// 㲢ʾʱ
 		double end = omp_get_wtime();
 		timeConsume = end - start;
+        std::cout << std::endl << "Samples per pixel: " << std::fixed << std::setprecision(2)
+            << samplesTaken << " / " << spp << " in " << passesDone << " passes";
+        if (timeBudget > 0)
+            std::cout << ", " << timeConsume << " s of " << timeBudget << " s budget";
+        if (adaptive) {
+            int minN = spp, maxN = 0, nConverged = 0;
+            for (const PixelStats& ps : pixelStats) {
+                minN = std::min(minN, ps.n);
+                maxN = std::max(maxN, ps.n);
+                if (ps.RelativeError() <= targetError) ++nConverged;
+            }
+            std::cout << " | adaptive: min " << minN << " / max " << maxN << " spp, "
+                << 100.f * nConverged / std::max(nPixels, 1) << "% pixels below error " << std::setprecision(4) << targetError;
+        }
+        reportTileTimes(scheduler, tileTime, tileThread, threadBusy);
+        ReportStats(timeConsume);
 	}
 
+    // ֲʽȾЭߣ񰴱ȡڰƬ˳ŶӣеĹÿȡһ
+    // ΪȨۼӵƬ뵥Ⱦۼӷʽͬ
+    bool SamplerIntegrator::RenderCoordinator(const Scene& scene, Listener& listener, double& timeConsume,
+        double idleTimeout) {
+        double start = omp_get_wtime();
+        uint64_t fingerprint = renderFingerprint(scene);
+        int spp = (int)sampler->samplesPerPixel;
+        int passSpp = sppPerPass > 0 ? std::min(sppPerPass, spp) : spp;
+        int nPasses = (spp + passSpp - 1) / passSpp;
+
+        // Ƭ˳뵥Ⱦͬ
+        TileScheduler scheduler(pixelBounds, tileSize, tileOrder, 1);
+        int nTiles = scheduler.TileCount();
+        std::vector<int> tileList;
+        int tileIndex;
+        while (scheduler.Next(0, &tileIndex)) tileList.push_back(tileIndex);
+        std::vector<RenderTask> tasks;
+        for (int pass = 0; pass < nPasses; ++pass) {
+            for (int t : tileList) {
+                Bounds2i b = scheduler.TileBounds(t);
+                RenderTask task = { (int32_t)tasks.size(), b.pMin.x, b.pMin.y, b.pMax.x, b.pMax.y,
+                    pass * passSpp, std::min((pass + 1) * passSpp, spp) };
+                tasks.push_back(task);
+            }
+        }
+        std::deque<int> pending;
+        for (int i = 0; i < (int)tasks.size(); ++i) pending.push_back(i);
+        std::vector<int> passRemaining(nPasses, nTiles);
+
+        // ÿ̵ӡǷͨ֡Ⱦ-1ΪУ
+        struct Worker {
+            std::unique_ptr<Connection> connection;
+            bool ready = false;
+            int task = -1;
+            int tasksDone = 0;
+        };
+        std::vector<Worker> workers;
+        auto dispatch = [&](Worker& worker) {
+            if (pending.empty()) return;
+            int id = pending.front();
+            pending.pop_front();
+            if (worker.connection->Send(MessageType::Task, &tasks[id], sizeof(RenderTask)))
+                worker.task = id;
+            else
+                pending.push_front(id);
+        };
+
+        m_FrameBuffer->ClearAccumulation();
+        samplesTaken = 0;
+        int tasksDone = 0, passesDone = 0, nRequeued = 0;
+        bool success = true;
+        // мʱӵһֺſʼҪȼسBVHŻӣԶidleTimeout
+        bool anyReady = false;
+        double lastActive = omp_get_wtime();
+        std::vector<char> payload;
+        while (tasksDone < (int)tasks.size()) {
+            std::vector<Connection*> connections;
+            for (Worker& worker : workers) connections.push_back(worker.connection.get());
+            bool acceptable;
+            std::vector<int> readable;
+            if (!listener.Wait(connections, 1.0, &acceptable, &readable)) {
+                std::cerr << std::endl << "Distributed render: waiting for workers failed" << std::endl;
+                success = false;
+                break;
+            }
+            if (acceptable) {
+                Worker worker;
+                worker.connection = listener.Accept();
+                if (worker.connection) {
+                    // ƬΪtileSize x tileSizeᳬС
+                    worker.connection->SetMaxPayload(MessageType::Hello, sizeof(WorkerHello));
+                    worker.connection->SetMaxPayload(MessageType::Result,
+                        sizeof(RenderTask) + sizeof(float) * 4 * tileSize * tileSize);
+                    workers.push_back(std::move(worker));
+                }
+            }
+
+            bool stop = false;
+            for (int i : readable) {
+                Worker& worker = workers[i];
+                MessageType type;
+                if (!worker.connection->Receive(&type, &payload)) continue;
+                if (type == MessageType::Hello && !worker.ready) {
+                    // ȷϹȾͬһͼ񣬷˳
+                    WorkerHello hello;
+                    bool match = payload.size() == sizeof(WorkerHello);
+                    if (match) {
+                        memcpy(&hello, payload.data(), sizeof(hello));
+                        match = hello.version == DistributedProtocolVersion &&
+                            hello.x0 == pixelBounds.pMin.x && hello.y0 == pixelBounds.pMin.y &&
+                            hello.x1 == pixelBounds.pMax.x && hello.y1 == pixelBounds.pMax.y &&
+                            hello.samplesPerPixel == spp;
+                    }
+                    // Ⱦͬ˲ͬĳĹܾͬƬᱻĺϲ
+                    bool sameScene = match && hello.fingerprint == fingerprint;
+                    if (!sameScene) {
+                        std::cerr << std::endl << (match ?
+                            "Distributed render: rejected a worker with a different scene, camera or integrator" :
+                            "Distributed render: rejected a worker with different render settings") << std::endl;
+                        worker.connection->Send(MessageType::Done, nullptr, 0);
+                        worker.connection->Close();
+                        continue;
+                    }
+                    worker.ready = true;
+                    anyReady = true;
+                    dispatch(worker);
+                }
+                else if (type == MessageType::Result && worker.task >= 0 &&
+                    payload.size() >= sizeof(RenderTask) &&
+                    memcmp(payload.data(), &tasks[worker.task], sizeof(RenderTask)) == 0) {
+                    const RenderTask& task = tasks[worker.task];
+                    int tileWidth = task.x1 - task.x0, tileHeight = task.y1 - task.y0;
+                    if (payload.size() != sizeof(RenderTask) + sizeof(float) * 4 * tileWidth * tileHeight) {
+                        worker.connection->Close();
+                        continue;
+                    }
+                    // ϲƬעYᷭת
+                    const float* result = (const float*)(payload.data() + sizeof(RenderTask));
+                    for (int y = task.y0; y < task.y1; ++y) {
+                        for (int x = task.x0; x < task.x1; ++x, result += 4)
+                            m_FrameBuffer->AddSample(x, pixelBounds.pMax.y - y - 1, result, result[3]);
+                    }
+                    int pass = task.sampleStart / passSpp;
+                    --passRemaining[pass];
+                    ++tasksDone;
+                    ++worker.tasksDone;
+                    worker.task = -1;
+                    dispatch(worker);
+
+                    // ·úıɣ˳ƽɵı
+                    while (!stop && passesDone < nPasses && passRemaining[passesDone] == 0) {
+                        ++passesDone;
+                        samplesTaken = (float)std::min(passesDone * passSpp, spp);
+                        stop = passCallback && !passCallback((int)samplesTaken);
+                        if (!previewFile.empty() && (stop || passesDone % previewInterval == 0)) {
+                            m_FrameBuffer->Resolve();
+                            if (!m_FrameBuffer->WriteImage(previewFile.c_str()))
+                                std::cerr << std::endl << "Failed to write preview " << previewFile << std::endl;
+                        }
+                    }
+                }
+                else {
+                    std::cerr << std::endl << "Distributed render: unexpected message from a worker" << std::endl;
+                    worker.connection->Close();
+                }
+            }
+            if (stop) break;
+
+            // ϿĹϵŻضף̾첹
+            int nActive = 0;
+            for (Worker& worker : workers) {
+                if (!worker.connection->IsOpen() && worker.task >= 0) {
+                    pending.push_front(worker.task);
+                    worker.task = -1;
+                    ++nRequeued;
+                }
+            }
+            for (Worker& worker : workers) {
+                if (!worker.connection->IsOpen()) continue;
+                ++nActive;
+                if (worker.ready && worker.task < 0) dispatch(worker);
+            }
+            workers.erase(std::remove_if(workers.begin(), workers.end(),
+                [](const Worker& worker) { return !worker.connection->IsOpen(); }), workers.end());
+
+            if (nActive > 0 || !anyReady) lastActive = omp_get_wtime();
+            else if (omp_get_wtime() - lastActive > idleTimeout) {
+                std::cerr << std::endl << "Distributed render: no workers for " << idleTimeout << " s" << std::endl;
+                success = false;
+                break;
+            }
+            std::cout << "\rRendering progress: " << std::fixed << std::setprecision(2)
+                << 100.0f * tasksDone / tasks.size() << "% (" << nActive << " workers)" << std::flush;
+        }
+        // ֪ͨй̽
+        int nWorkers = (int)workers.size();
+        for (Worker& worker : workers) worker.connection->Send(MessageType::Done, nullptr, 0);
+        workers.clear();
+        m_FrameBuffer->Resolve();
+
+        double end = omp_get_wtime();
+        timeConsume = end - start;
+        std::cout << std::endl << "Samples per pixel: " << std::fixed << std::setprecision(2)
+            << samplesTaken << " / " << spp << " in " << passesDone << " passes | distributed: "
+            << tasks.size() << " tasks (" << nTiles << " tiles x " << nPasses << " passes), "
+            << tasksDone << " done, " << nRequeued << " reassigned, " << nWorkers << " workers at end"
+            << std::endl;
+        return success;
+    }
+
+    // ֲʽȾḶ́ȾЭ߷Ƭڵɶ̶̬߳
+    bool SamplerIntegrator::RenderWorker(const Scene& scene, const std::string& host, int port) {
+        int nRenderThreads = nThreads > 0 ? nThreads : (int)std::thread::hardware_concurrency();
+        if (nRenderThreads <= 0) nRenderThreads = omp_get_num_procs();
+        Connection connection;
+        if (!connection.Connect(host, port)) {
+            std::cerr << "Worker: failed to connect to " << host << ":" << port << std::endl;
+            return false;
+        }
+        connection.SetMaxPayload(MessageType::Task, sizeof(RenderTask));
+        Preprocess(scene, *sampler);
+        WorkerHello hello = { DistributedProtocolVersion, pixelBounds.pMin.x, pixelBounds.pMin.y,
+            pixelBounds.pMax.x, pixelBounds.pMax.y, (int64_t)sampler->samplesPerPixel,
+            renderFingerprint(scene) };
+        if (!connection.Send(MessageType::Hello, &hello, sizeof(hello))) {
+            std::cerr << "Worker: lost connection to the coordinator" << std::endl;
+            return false;
+        }
+
+        std::vector<char> payload, result;
+        int nTasks = 0;
+        for (;;) {
+            MessageType type;
+            if (!connection.Receive(&type, &payload)) {
+                std::cerr << "Worker: lost connection to the coordinator" << std::endl;
+                return false;
+            }
+            if (type == MessageType::Done) break;
+            if (type != MessageType::Task || payload.size() != sizeof(RenderTask)) {
+                std::cerr << "Worker: unexpected message from the coordinator" << std::endl;
+                return false;
+            }
+            RenderTask task;
+            memcpy(&task, payload.data(), sizeof(task));
+            int tileWidth = task.x1 - task.x0, tileHeight = task.y1 - task.y0;
+            int nTilePixels = tileWidth * tileHeight;
+            result.resize(sizeof(RenderTask) + sizeof(float) * 4 * nTilePixels);
+            memcpy(result.data(), &task, sizeof(task));
+            float* out = (float*)(result.data() + sizeof(RenderTask));
+
+#pragma omp parallel num_threads(nRenderThreads)
+            {
+                std::unique_ptr<Sampler> pixelSampler = sampler->Clone(0);
+                MemoryArena arena;
+#pragma omp for schedule(dynamic, 1)
+                for (int i = 0; i < nTilePixels; ++i) {
+                    Point2i pixel(task.x0 + i % tileWidth, task.y0 + i / tileWidth);
+                    samplePixel(scene, *pixelSampler, arena, pixel, task.sampleStart, task.sampleEnd,
+                        out + 4 * i, nullptr);
+                    out[4 * i + 3] = (float)(task.sampleEnd - task.sampleStart);
+                }
+                MergeThreadStats();
+            }
+            if (!connection.Send(MessageType::Result, result.data(), result.size())) {
+                std::cerr << "Worker: lost connection to the coordinator" << std::endl;
+                return false;
+            }
+            ++nTasks;
+        }
+        std::cout << "Worker: rendered " << nTasks << " tasks" << std::endl;
+        return true;
+    }
+
+    uint64_t SamplerIntegrator::renderFingerprint(const Scene& scene) const {
+        // ṩģļϣܴӳõϢΧСԴ빦
+        uint64_t h = HashBytes(&sceneFingerprint, sizeof(sceneFingerprint));
+        Bounds3f bounds = scene.WorldBound();
+        h = HashBytes(&bounds, sizeof(bounds), h);
+        for (const auto& light : scene.lights) {
+            const char* name = typeid(*light).name();
+            h = HashBytes(name, strlen(name), h);
+            float power[3];
+            light->Power().ToRGB(power);
+            int params[2] = { light->flags, light->nSamples };
+            h = HashBytes(power, sizeof(power), h);
+            h = HashBytes(params, sizeof(params), h);
+        }
+        // ͺͲ
+        const char* cameraName = typeid(*camera).name();
+        h = HashBytes(cameraName, strlen(cameraName), h);
+        uint64_t cameraHash = camera->ParameterHash();
+        h = HashBytes(&cameraHash, sizeof(cameraHash), h);
+        const char* samplerName = typeid(*sampler).name();
+        h = HashBytes(samplerName, strlen(samplerName), h);
+        const char* integratorName = typeid(*this).name();
+        h = HashBytes(integratorName, strlen(integratorName), h);
+        uint64_t integratorHash = ParameterHash();
+        return HashBytes(&integratorHash, sizeof(integratorHash), h);
+    }
+
+    // һص[firstSample, lastSample)ΧrgbΪЩƽֵsRGB
+    // statsΪʱͬʱۼͳ
+    void SamplerIntegrator::samplePixel(const Scene& scene, Sampler& pixelSampler, MemoryArena& arena,
+        const Point2i& pixel, int firstSample, int lastSample, float rgb[3], PixelStats* stats) const {
+        // رΪòClone(offset)ͬ
+        int offset = (pixelBounds.pMax.x * pixel.y + pixel.x);
+        pixelSampler.Reseed(offset);
+        pixelSampler.StartPixel(pixel);
+        // һĵһһβȫʱͬ
+        pixelSampler.SetSampleNumber(firstSample);
+        // ʼɫΪɫ
+        Spectrum colObj(0.0f);
+        // ʼԵؽжβ
+        for (int sampleIndex = firstSample; sampleIndex < lastSample; ++sampleIndex) {
+            // Ӳȡ
+            CameraSample cameraSample = pixelSampler.GetCameraSample(pixel);
+            // һ
+            RayDifferential r;
+            float rayWeight =
+                camera->GenerateRayDifferential(cameraSample, &r);
+            r.ScaleDifferentials(
+                1 / std::sqrt((float)pixelSampler.samplesPerPixel));
+
+            //ʵֵ Li() ɫ
+            Spectrum L = Li(r, scene, pixelSampler, arena, 0);
+            colObj += L;
+            if (stats) stats->Add(L.y());
+            // һձɫڴ
+            arena.Reset();
+            pixelSampler.StartNextSample(); // ƶǰصһ
+        }
+
+        // ƽֵתsRGB
+        colObj /= (float)(lastSample - firstSample);
+        float xyz[3];
+        colObj.ToXYZ(xyz);
+        XYZToRGB(xyz, rgb);
+    }
+
+    // ӦֵtargetErrorδ޵ضҪ
+    // ԤʱԤֻmaxPixelsٲһʱֻmaxPixels
+    bool SamplerIntegrator::adaptiveThreshold(int spp, int passSpp, int64_t samplesDone,
+        int64_t maxPixels, float* threshold) {
+        int nPixels = (int)pixelStats.size();
+        std::vector<float> candidates;
+        for (int i = 0; i < nPixels; ++i) {
+            const PixelStats& ps = pixelStats[i];
+            pixelError[i] = ps.n < spp ? ps.RelativeError() : 0.f;
+            if (pixelError[i] > targetError) candidates.push_back(pixelError[i]);
+        }
+        *threshold = targetError;
+        if (candidates.empty()) return false;
+        if (sampleBudget > 0) {
+            int64_t remaining = (int64_t)((double)sampleBudget * nPixels) - samplesDone;
+            int64_t budgetPixels = remaining / passSpp;
+            maxPixels = maxPixels >= 0 ? std::min(maxPixels, budgetPixels) : budgetPixels;
+        }
+        if (maxPixels >= 0) {
+            if (maxPixels <= 0) return false;
+            if ((int64_t)candidates.size() > maxPixels) {
+                std::nth_element(candidates.begin(), candidates.begin() + maxPixels,
+                    candidates.end(), std::greater<float>());
+                *threshold = candidates[maxPixels];
+                // ͬʱûϸֵʱ
+                float t = *threshold;
+                if (std::none_of(candidates.begin(), candidates.end(),
+                    [t](float e) { return e > t; }))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Ƭʱܣ/ƽ/Ƭ߳æµʱĲȡȡ
+    // ԼļƬtileTimeFileʱÿƬĺʱдCSV
+    void SamplerIntegrator::reportTileTimes(const TileScheduler& scheduler,
+        const std::vector<double>& tileTime, const std::vector<int>& tileThread,
+        const std::vector<double>& threadBusy) const {
+        int nTiles = (int)tileTime.size();
+        if (nTiles == 0) return;
+        double minTime = tileTime[0], maxTime = tileTime[0], sumTime = 0;
+        for (double t : tileTime) {
+            minTime = std::min(minTime, t);
+            maxTime = std::max(maxTime, t);
+            sumTime += t;
+        }
+        double maxBusy = 0, sumBusy = 0;
+        int nSteals = 0;
+        for (int i = 0; i < (int)threadBusy.size(); ++i) {
+            maxBusy = std::max(maxBusy, threadBusy[i]);
+            sumBusy += threadBusy[i];
+            nSteals += scheduler.StealCount(i);
+        }
+        double avgBusy = sumBusy / threadBusy.size();
+        std::cout << std::endl << "Tiles: " << nTiles << " (" << tileSize << "x" << tileSize
+            << "), threads " << threadBusy.size() << ", steals " << nSteals
+            << " | tile time min " << std::fixed << std::setprecision(2) << 1000 * minTime
+            << " / avg " << 1000 * sumTime / nTiles << " / max " << 1000 * maxTime
+            << " ms | thread busy max/avg " << (avgBusy > 0 ? maxBusy / avgBusy : 1.0)
+            << std::endl;
+
+        // 5Ƭ
+        std::vector<int> order(nTiles);
+        for (int i = 0; i < nTiles; ++i) order[i] = i;
+        int nSlowest = std::min(nTiles, 5);
+        std::partial_sort(order.begin(), order.begin() + nSlowest, order.end(),
+            [&](int a, int b) { return tileTime[a] > tileTime[b]; });
+        std::cout << "Slowest tiles:";
+        for (int i = 0; i < nSlowest; ++i) {
+            Bounds2i b = scheduler.TileBounds(order[i]);
+            std::cout << " [" << b.pMin.x << "," << b.pMin.y << "] " << 1000 * tileTime[order[i]] << " ms;";
+        }
+        std::cout << std::endl;
+
+        if (!tileTimeFile.empty()) {
+            std::ofstream out(tileTimeFile);
+            out << "x0,y0,x1,y1,ms,thread\n";
+            for (int i = 0; i < nTiles; ++i) {
+                Bounds2i b = scheduler.TileBounds(i);
+                out << b.pMin.x << "," << b.pMin.y << "," << b.pMax.x << "," << b.pMax.y << ","
+                    << 1000 * tileTime[i] << "," << tileThread[i] << "\n";
+            }
+        }
+    }
+
     Spectrum SamplerIntegrator::Li(const RayDifferential& ray, const Scene& scene,
-        Sampler& sampler, int depth) const {
+        Sampler& sampler, MemoryArena& arena, int depth) const {
         PBR::SurfaceInteraction isect;
 
         PBR::Spectrum colObj;
@@ -370,7 +943,7 @@ namespace PBR{
 
                 if (vist.Unoccluded(scene)) {
                     //ɢ
-                    isect.ComputeScatteringFunctions(ray);
+                    isect.ComputeScatteringFunctions(ray, arena);
                     // ˵woӰĽ
                     Vector3f wo = isect.wo;
                     Spectrum f = isect.bsdf->f(wo, wi);
@@ -4,15 +4,27 @@
 #include "Core\PBR.h"
 #include "Core\Geometry.h"
 #include "Core\FrameBuffer.h"
+#include "Core\Memory.h"
+#include "Integrator\TileScheduler.h"
+#include <algorithm>
+#include <functional>
+#include <string>
 
 namespace PBR{
+	class Listener;
+
 	// 
 	class Integrator {
 	public:
 		virtual ~Integrator() {}
 		// ҪʵȾȾ̵
 		virtual void Render(const Scene& scene, double& timeConsume) = 0;
+		// ȾǽʱԤ㣨룩0ΪơʽȾĻԤʱֹͣ׷ǰ
+		void SetTimeBudget(double seconds) { timeBudget = seconds; }
 		float IntegratorRenderTime; //Ⱦһõʱ
+
+	protected:
+		double timeBudget = 0;
 	};
 
 	//֣ԴȲйԴ
@@ -42,24 +54,126 @@ namespace PBR{
 		virtual void Preprocess(const Scene& scene, Sampler& sampler) {}
 		// Ⱦ
 		void Render(const Scene& scene, double& timeConsume);
+		// ȾãƬ߳߳0ΪӲ߳Ƭ˳
+		// ƬʱCSVļΪֻڿ̨ܣ
+		void SetRenderOptions(int tileSize, int nThreads = 0,
+			TileOrder tileOrder = TileOrder::Morton,
+			const std::string& tileTimeFile = "") {
+			this->tileSize = tileSize;
+			this->nThreads = nThreads;
+			this->tileOrder = tileOrder;
+			this->tileTimeFile = tileTimeFile;
+		}
+		// ʽȾÿһͼÿ׷sppPerPass0Ϊһ꣩
+		// ۼFrameBufferHDRУÿpreviewIntervalѵǰдpreviewFileΪд
+		void SetProgressive(int sppPerPass, const std::string& previewFile = "",
+			int previewInterval = 1) {
+			this->sppPerPass = sppPerPass;
+			this->previewFile = previewFile;
+			this->previewInterval = std::max(previewInterval, 1);
+		}
+		// ÿһãΪɵÿfalseʱһȾ
+		void SetPassCallback(std::function<bool(int)> passCallback) {
+			this->passCallback = passCallback;
+		}
+		// ӦÿȲminSamples֮ÿһֻԴtargetError
+		// ׷صΪsamplesPerPixelsampleBudget0ʱͼ
+		// ƽÿʣԤ㲻δʱȸءtargetErrorΪ0ʱر
+		void SetAdaptive(float targetError, int minSamples = 16, float sampleBudget = 0) {
+			this->targetError = targetError;
+			this->minSamples = std::max(minSamples, 2);
+			this->sampleBudget = sampleBudget;
+		}
+		// ָƣͺͲԴΧУټﴫ
+		// sceneFingerprintһģļFileHashϵֲʽȾĹ̶Ҫָһ
+		void SetSceneFingerprint(uint64_t sceneFingerprint) { this->sceneFingerprint = sceneFingerprint; }
+		// ϵ֣ÿinterval루һʱѽƬԭӵдcheckpointFileȾʱдһΡ
+		// RenderʼʱļȾ볡ָһ£ʹӶϵ벻жϵȾλͬ
+		void SetCheckpoint(const std::string& checkpointFile, double interval = 300) {
+			this->checkpointFile = checkpointFile;
+			this->checkpointInterval = interval;
+		}
+		// ֲʽȾЭߣÿһƬΪָͨlistenerḶ́ϲƬ
+		// ̶Ͽʱϵ·䡣ֻʹýʽãsppPerPassԤÿص
+		// ָsceneһµḺܾ́
+		// һ֮󣬳idleTimeoutûκιʱʧܷfalse
+		bool RenderCoordinator(const Scene& scene, Listener& listener, double& timeConsume,
+			double idleTimeout = 60);
+		// ֲʽȾḶ́host:portϵЭߣȾյֱЭ֪ͨ
+		bool RenderWorker(const Scene& scene, const std::string& host, int port);
+		// һȾʵɵƽÿ
+		float SamplesTaken() const { return samplesTaken; }
 
 		// ռ
-		virtual Spectrum Li(const RayDifferential& ray, const Scene& scene, Sampler& sampler, int depth = 0) const;
+		// BSDFɫڼʱarena䣬ÿ
+		virtual Spectrum Li(const RayDifferential& ray, const Scene& scene, Sampler& sampler,
+			MemoryArena& arena, int depth = 0) const;
 		// 뾵淴
 		Spectrum SpecularReflect(const RayDifferential& ray,
 			const SurfaceInteraction& isect,
 			const Scene& scene, Sampler& sampler,
-			int depth) const;
+			MemoryArena& arena, int depth) const;
 		Spectrum SpecularTransmit(const RayDifferential& ray,
 			const SurfaceInteraction& isect,
-			const Scene& scene, Sampler& sampler, int depth) const;
+			const Scene& scene, Sampler& sampler, MemoryArena& arena, int depth) const;
 	protected:
+		// ȵȣĹϣһдϵ㣬仯ɶϵ
+		virtual uint64_t ParameterHash() const { return 0; }
+
 		std::shared_ptr<const Camera> camera;
 
 	private:
+		// ӦصͳƣWelford㷨߸¾ֵ뷽
+		struct PixelStats {
+			int n = 0;
+			float mean = 0, m2 = 0;
+			void Add(float v) {
+				++n;
+				float delta = v - mean;
+				mean += delta / n;
+				m2 += delta * (v - mean);
+			}
+			// ؾֵԱ׼ذ0.01ȼ㣬Խӽ0ľֵ
+			float RelativeError() const {
+				if (n < 2) return Infinity;
+				float variance = m2 / (n - 1);
+				return std::sqrt(variance / n) / std::max(mean, 0.01f);
+			}
+		};
+		// һص[firstSample, lastSample)ΧrgbΪƽֵstatsΪʱۼͳ
+		void samplePixel(const Scene& scene, Sampler& pixelSampler, MemoryArena& arena,
+			const Point2i& pixel, int firstSample, int lastSample, float rgb[3], PixelStats* stats) const;
+		// һصֵֵؼmaxPixelsС0Ϊޣ
+		// ûҪʱfalse
+		bool adaptiveThreshold(int spp, int passSpp, int64_t samplesDone, int64_t maxPixels,
+			float* threshold);
+		// дϵֲʽֵĳָ
+		uint64_t renderFingerprint(const Scene& scene) const;
+
+		void reportTileTimes(const TileScheduler& scheduler,
+			const std::vector<double>& tileTime, const std::vector<int>& tileThread,
+			const std::vector<double>& threadBusy) const;
+
 		std::shared_ptr<Sampler> sampler;
 		const Bounds2i pixelBounds;
 		FrameBuffer* m_FrameBuffer;
+		int tileSize = 16;
+		int nThreads = 0;
+		TileOrder tileOrder = TileOrder::Morton;
+		std::string tileTimeFile;
+		int sppPerPass = 0;
+		std::string previewFile;
+		int previewInterval = 1;
+		std::function<bool(int)> passCallback;
+		float samplesTaken = 0;
+		float targetError = 0;
+		int minSamples = 16;
+		float sampleBudget = 0;
+		std::string checkpointFile;
+		double checkpointInterval = 300;
+		uint64_t sceneFingerprint = 0;
+		std::vector<PixelStats> pixelStats;
+		std::vector<float> pixelError;
 	};
 
 
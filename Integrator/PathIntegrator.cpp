@@ -6,13 +6,11 @@
 #include "Material\Reflection.h"
 #include "Sampler\Sampler.h"
 #include "Light\Light.h"
+#include "Core\Stats.h"
+#include "Core\MappedFile.h"
 
 namespace PBR {
 
-	static long long totalPaths = 0;
-	static long long zeroRadiancePaths = 0;
-	static long long pathLength = 0;
-
 	PathIntegrator::PathIntegrator(int maxDepth,
 		std::shared_ptr<const Camera> camera,
 		std::shared_ptr<Sampler> sampler,
@@ -23,6 +21,12 @@ namespace PBR {
 		rrThreshold(rrThreshold),
 		lightSampleStrategy(lightSampleStrategy) {}
 
+	uint64_t PathIntegrator::ParameterHash() const {
+		uint64_t h = HashBytes(&maxDepth, sizeof(maxDepth));
+		h = HashBytes(&rrThreshold, sizeof(rrThreshold), h);
+		return HashBytes(lightSampleStrategy.data(), lightSampleStrategy.size(), h);
+	}
+
 	// ղԣȲȨ
 	void PathIntegrator::Preprocess(const Scene& scene, Sampler& sampler) {
 		lightDistribution =
@@ -30,7 +34,7 @@ namespace PBR {
 	}
 
 	Spectrum PathIntegrator::Li(const RayDifferential& r, const Scene& scene,
-		Sampler& sampler, int depth) const {
+		Sampler& sampler, MemoryArena& arena, int depth) const {
 		//ɫL·ǰȨbetaۼƲ˥
 		Spectrum L(0.f), beta(1.f);
 		Ray ray(r);
@@ -60,7 +64,7 @@ namespace PBR {
 			if (!foundIntersection || bounces >= maxDepth) break;
 
 			// زʣΪգùߴ
-			isect.ComputeScatteringFunctions(ray, true);
+			isect.ComputeScatteringFunctions(ray, arena, true);
 			if (!isect.bsdf) {
 				ray = isect.SpawnRay(ray.d);
 				bounces--;
@@ -72,11 +76,11 @@ namespace PBR {
 
 			// Ǿ
 			if (isect.bsdf->NumComponents(BxDFType(BSDF_ALL & ~BSDF_SPECULAR)) > 0) {
-				++totalPaths;
+				STAT_INC(Paths);
 				// õֱӹ
 				// ʹѡһԴĲԣҪԲӰ
 				Spectrum Ld = beta * UniformSampleOneLight(isect, scene, sampler, false, distrib);
-				if (Ld.IsBlack()) ++zeroRadiancePaths;
+				if (Ld.IsBlack()) STAT_INC(ZeroRadiancePaths);
 				L += Ld;
 			}
 
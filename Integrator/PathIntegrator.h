@@ -20,9 +20,11 @@ namespace PBR {
         void Preprocess(const Scene& scene, Sampler& sampler);
         // һմص
         Spectrum Li(const RayDifferential& ray, const Scene& scene,
-            Sampler& sampler, int depth) const;
+            Sampler& sampler, MemoryArena& arena, int depth) const;
 
     private:
+        uint64_t ParameterHash() const;
+
         // PathIntegrator Private Data
         const int maxDepth;
         const float rrThreshold;
@@ -0,0 +1,117 @@
+#include "Integrator\TileScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace PBR {
+
+	static inline uint64_t packRange(uint32_t begin, uint32_t end) {
+		return ((uint64_t)begin << 32) | end;
+	}
+
+	// xĵ16λλչڶάMorton
+	static inline uint32_t LeftShift2(uint32_t x) {
+		x &= 0x0000ffff;
+		x = (x | (x << 8)) & 0x00ff00ff;
+		x = (x | (x << 4)) & 0x0f0f0f0f;
+		x = (x | (x << 2)) & 0x33333333;
+		x = (x | (x << 1)) & 0x55555555;
+		return x;
+	}
+
+	static inline uint32_t EncodeMorton2(const Point2i& p) {
+		return (LeftShift2(p.y) << 1) | LeftShift2(p.x);
+	}
+
+	TileScheduler::TileScheduler(const Bounds2i& pixelBounds, int tileSize,
+		TileOrder order, int nThreads)
+		: pixelBounds(pixelBounds), tileSize(std::max(tileSize, 1)),
+		nThreads(std::max(nThreads, 1)) {
+		Vector2i extent = pixelBounds.Diagonal();
+		Point2i nTiles((extent.x + this->tileSize - 1) / this->tileSize,
+			(extent.y + this->tileSize - 1) / this->tileSize);
+		tiles.reserve(nTiles.x * nTiles.y);
+		for (int y = 0; y < nTiles.y; ++y)
+			for (int x = 0; x < nTiles.x; ++x)
+				tiles.push_back(Point2i(x, y));
+
+		// Morton˳ڵƬڿռҲڣ
+		// ˳ͼһȦȦ⣬ȳǻ
+		if (order == TileOrder::Morton) {
+			std::stable_sort(tiles.begin(), tiles.end(),
+				[](const Point2i& a, const Point2i& b) {
+				return EncodeMorton2(a) < EncodeMorton2(b);
+			});
+		}
+		else if (order == TileOrder::Spiral) {
+			float cx = 0.5f * (nTiles.x - 1), cy = 0.5f * (nTiles.y - 1);
+			std::stable_sort(tiles.begin(), tiles.end(),
+				[cx, cy](const Point2i& a, const Point2i& b) {
+				float ra = std::max(std::abs(a.x - cx), std::abs(a.y - cy));
+				float rb = std::max(std::abs(b.x - cx), std::abs(b.y - cy));
+				if (ra != rb) return ra < rb;
+				return std::atan2(a.y - cy, a.x - cx) < std::atan2(b.y - cy, b.x - cx);
+			});
+		}
+
+		queues.reset(new WorkQueue[this->nThreads]);
+		for (int i = 0; i < this->nThreads; ++i)
+			queues[i].nSteals = 0;
+		Reset();
+	}
+
+	void TileScheduler::Reset() {
+		// ˳Ƭָ߳
+		int nTotal = (int)tiles.size();
+		for (int i = 0; i < nThreads; ++i) {
+			uint32_t begin = (uint32_t)((int64_t)nTotal * i / nThreads);
+			uint32_t end = (uint32_t)((int64_t)nTotal * (i + 1) / nThreads);
+			queues[i].range.store(packRange(begin, end));
+		}
+	}
+
+	bool TileScheduler::Next(int threadIndex, int* tileIndex) {
+		WorkQueue& queue = queues[threadIndex];
+		while (true) {
+			uint64_t range = queue.range.load();
+			uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+			if (begin < end) {
+				if (queue.range.compare_exchange_weak(range, packRange(begin + 1, end))) {
+					*tileIndex = (int)begin;
+					return true;
+				}
+				continue;
+			}
+			// ԼĶѿգȥ߳ȡ
+			if (!steal(threadIndex)) return false;
+		}
+	}
+
+	bool TileScheduler::steal(int threadIndex) {
+		for (int k = 1; k < nThreads; ++k) {
+			WorkQueue& victim = queues[(threadIndex + k) % nThreads];
+			uint64_t range = victim.range.load();
+			while (true) {
+				uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+				if (begin >= end) break;
+				// βȡһ루һ
+				uint32_t mid = end - (end - begin + 1) / 2;
+				if (victim.range.compare_exchange_weak(range, packRange(begin, mid))) {
+					// ԼĶΪʱ̲߳޸ֱд
+					queues[threadIndex].range.store(packRange(mid, end));
+					++queues[threadIndex].nSteals;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	Bounds2i TileScheduler::TileBounds(int tileIndex) const {
+		const Point2i& tile = tiles[tileIndex];
+		Point2i p0 = pixelBounds.pMin + Vector2i(tile.x * tileSize, tile.y * tileSize);
+		Point2i p1(std::min(p0.x + tileSize, pixelBounds.pMax.x),
+			std::min(p0.y + tileSize, pixelBounds.pMax.y));
+		return Bounds2i(p0, p1);
+	}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef __TileScheduler_h__
+#define __TileScheduler_h__
+
+#include "Core\PBR.h"
+#include "Core\Geometry.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace PBR {
+
+	// Ƭı˳
+	enum class TileOrder { Scanline, Morton, Spiral };
+
+	// Ƭͼ񻮷ΪtileSizetileSizeƬ
+	// ÿ߳쵽˳һƬӶȡ
+	// ԼĶȡպ󣬴̶߳еβȡһ
+	class TileScheduler {
+	public:
+		TileScheduler(const Bounds2i& pixelBounds, int tileSize, TileOrder order, int nThreads);
+		// °Ƭָ̣߳ڽʽȾһ飻ȡۼ
+		void Reset();
+		// ߳threadIndexȡһƬƬѷֳʱfalse
+		bool Next(int threadIndex, int* tileIndex);
+		// ƬطΧ
+		Bounds2i TileBounds(int tileIndex) const;
+		int TileCount() const { return (int)tiles.size(); }
+		int StealCount(int threadIndex) const { return queues[threadIndex].nSteals; }
+
+	private:
+		// ÿ̵߳ĶУ32λΪbegin32λΪendtilesе±ꡣ
+		// ȡƬȡͨCAS޸ģ뵽һбα
+		struct WorkQueue {
+			std::atomic<uint64_t> range;
+			int nSteals;
+			char pad[64 - sizeof(std::atomic<uint64_t>) - sizeof(int)];
+		};
+		bool steal(int threadIndex);
+
+		const Bounds2i pixelBounds;
+		const int tileSize;
+		const int nThreads;
+		// ˳źõƬ
+		std::vector<Point2i> tiles;
+		std::unique_ptr<WorkQueue[]> queues;
+	};
+
+}
+
+#endif
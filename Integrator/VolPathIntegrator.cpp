@@ -7,11 +7,16 @@
 #include "Material\Reflection.h"
 #include "Integrator\VolPathIntegrator.h"
 #include "Core\Spectrum.h"
+#include "Core\Stats.h"
+#include "Core\MappedFile.h"
 
 namespace PBR {
 
-static long long volumeInteractions = 0;
-static long long surfaceInteractions = 0;
+uint64_t VolPathIntegrator::ParameterHash() const {
+	uint64_t h = HashBytes(&maxDepth, sizeof(maxDepth));
+	h = HashBytes(&rrThreshold, sizeof(rrThreshold), h);
+	return HashBytes(lightSampleStrategy.data(), lightSampleStrategy.size(), h);
+}
 
 void VolPathIntegrator::Preprocess(const Scene &scene, Sampler &sampler) {
 	lightDistribution =
@@ -19,7 +24,7 @@ void VolPathIntegrator::Preprocess(const Scene &scene, Sampler &sampler) {
 }
 
 Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
-	Sampler &sampler, int depth) const {	
+	Sampler &sampler, MemoryArena &arena, int depth) const {	
 	Spectrum L(0.f), beta(1.f);
 	RayDifferential ray(r);
 	bool specularBounce = false;
@@ -40,7 +45,7 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
 		if (mi.IsValid()) {
 			// 㴦ԴֱĹ
 			if (bounces >= maxDepth) break;
-			++volumeInteractions;
+			STAT_INC(VolumeInteractions);
 			const Distribution1D *lightDistrib =
 				lightDistribution->Lookup(mi.p);
 			L += beta * UniformSampleOneLight(mi, scene, sampler, true, lightDistrib);
@@ -53,7 +58,7 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
 		}
 		// ·׷һ
 		else {
-			++surfaceInteractions;
+			STAT_INC(SurfaceInteractions);
 			if (bounces == 0 || specularBounce) {
 				if (foundIntersection)
 					L += beta * isect.Le(-ray.d);
@@ -64,7 +69,7 @@ Spectrum VolPathIntegrator::Li(const RayDifferential &r, const Scene &scene,
 
 			if (!foundIntersection || bounces >= maxDepth) break;
 
-			isect.ComputeScatteringFunctions(ray, true);
+			isect.ComputeScatteringFunctions(ray, arena, true);
 			if (!isect.bsdf) {
 				ray = isect.SpawnRay(ray.d);
 				bounces--;
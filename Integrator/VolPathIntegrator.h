@@ -20,10 +20,12 @@ public:
 		rrThreshold(rrThreshold),
 		lightSampleStrategy(lightSampleStrategy) { }
 	Spectrum Li(const RayDifferential &ray, const Scene &scene,
-		Sampler &sampler, int depth) const;
+		Sampler &sampler, MemoryArena &arena, int depth) const;
 	void Preprocess(const Scene &scene, Sampler &sampler);
 
 private:
+	uint64_t ParameterHash() const;
+
 	const int maxDepth;
 	const float rrThreshold;
 	const std::string lightSampleStrategy;
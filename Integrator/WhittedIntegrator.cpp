@@ -5,11 +5,16 @@
 #include "Light\Light.h"
 #include "Sampler\Sampler.h"
 #include "Material\Reflection.h"
+#include "Core\MappedFile.h"
 
 
 namespace PBR {
+uint64_t WhittedIntegrator::ParameterHash() const {
+    return HashBytes(&maxDepth, sizeof(maxDepth));
+}
+
 Spectrum WhittedIntegrator::Li(const RayDifferential&ray, const Scene &scene,
-                               Sampler &sampler, int depth) const {
+                               Sampler &sampler, MemoryArena &arena, int depth) const {
     Spectrum L(0.);
     // ҹ볡
     SurfaceInteraction isect;
@@ -26,10 +31,10 @@ Spectrum WhittedIntegrator::Li(const RayDifferential&ray, const Scene &scene,
 
     // BSDF
     // ڲ primitive->material->ComputeScatteringFunctions() BSDF  isect.bsdf ָ
-    isect.ComputeScatteringFunctions(ray);
+    isect.ComputeScatteringFunctions(ray, arena);
 
     // ûBSDFԭ׷
-	if (!isect.bsdf) return Li(isect.SpawnRay(ray.d), scene, sampler, depth);
+	if (!isect.bsdf) return Li(isect.SpawnRay(ray.d), scene, sampler, arena, depth);
 
     // ԴۼԷ
     L += isect.Le(wo);
@@ -59,7 +64,7 @@ Spectrum WhittedIntegrator::Li(const RayDifferential&ray, const Scene &scene,
         // ڲBSDFͲʽжϵǰǷ淴
         // ɹطֵݹ
         // ݹ鱻
-		L += SpecularReflect(ray, isect, scene, sampler, depth);
+		L += SpecularReflect(ray, isect, scene, sampler, arena, depth);
     }
     return L;
 }
@@ -13,8 +13,10 @@ class WhittedIntegrator : public SamplerIntegrator {
         : SamplerIntegrator(camera, sampler, pixelBounds, m_FrameBuffer), maxDepth(maxDepth) {}
     // д߼㺯
     Spectrum Li(const RayDifferential&ray, const Scene &scene,
-                Sampler &sampler, int depth) const;
+                Sampler &sampler, MemoryArena &arena, int depth) const;
   private:
+    uint64_t ParameterHash() const;
+
     const int maxDepth;
 };
 
@@ -2,17 +2,16 @@
 
 #include "Core\Scene.h"
 #include "Core\interaction.h"
+#include "Core\Stats.h"
 
 namespace PBR {
-    static long long numLights = 0;
-    static long long numAreaLights = 0;
     Light::Light(int flags, const Transform& LightToWorld, const MediumInterface& mediumInterface, int nSamples)
         : flags(flags),
         nSamples(std::max(1, nSamples)),
         mediumInterface(mediumInterface),
         LightToWorld(LightToWorld),
         WorldToLight(Inverse(LightToWorld)) {
-        ++numLights;
+        STAT_INC(Lights);
     }
 
 
@@ -23,7 +22,7 @@ namespace PBR {
 
     AreaLight::AreaLight(const Transform& LightToWorld, const MediumInterface& medium, int nSamples)
         : Light((int)LightFlags::Area, LightToWorld, medium, nSamples) {
-        ++numAreaLights;
+        STAT_INC(AreaLights);
     }
 
     // ӵ p0  p1 Ĺ
@@ -2,6 +2,7 @@
 #include <memory>
 #include <vector>
 #include <iomanip> // ڸʽ
+#include <string>
 #include <omp.h>   // ڲмͼʱ
 
 #include "Core/FrameBuffer.h"
@@ -13,11 +14,12 @@
 #include "Shape/Triangle.h"
 #include "Shape/ModelLoad.h"
 #include "Core/Interaction.h"
-#include "Shape\plyRead.h"
+#include "Shape\PlyLoad.h"
 #include "Accelerator\BVHAccel.h"
 #include "Core/Primitive.h" // ȷ Primitive.h
 #include "Core/Spectrum.h"
 #include "Core\Scene.h"
+#include "Core\MappedFile.h"
 
 #include "Camera\Camera.h"
 #include "Camera\Perspective.h"
@@ -31,6 +33,7 @@
 #include "Integrator\PathIntegrator.h"
 #include "Integrator\DirectLightingIntegrator.h"
 #include "Integrator\VolPathIntegrator.h"
+#include "Integrator\Distributed.h"
 
 #include "Material\Material.h"
 #include "Material\MatteMaterial.h"
@@ -248,9 +251,17 @@ int main(int argc, char* argv[]) {
     PBR::ModelLoad fbxLoader;
     PBR::Transform fbx_Object2World = PBR::Translate(PBR::Vector3f(0.f, -200.f, -120.f)); //* PBR::Scale(0.5f, 0.5f, 0.5f);
     std::string fbxPath = "C:/Users/99531/Desktop/book/PBR-v1/Resources/dark-knight/source/Knight_All.fbx";
-    fbxLoader.loadModel(fbxPath, fbx_Object2World);
-    //fbxLoader.buildNoTextureModel(fbx_Object2World, noMedium, prims, plasticMaterial);
-    fbxLoader.buildTextureModel(fbx_Object2World, noMedium, prims);
+    // ģռزһBVHBLASTransformedPrimitiveʵ볡
+    // öʱBVHֻһ
+    std::vector<std::shared_ptr<PBR::Primitive>> knightPrims;
+    fbxLoader.loadModel(fbxPath, PBR::Transform());
+    //fbxLoader.buildNoTextureModel(PBR::Transform(), noMedium, knightPrims, plasticMaterial);
+    fbxLoader.buildTextureModel(PBR::Transform(), noMedium, knightPrims);
+    std::shared_ptr<PBR::Primitive> knight =
+        std::make_shared<BVHAccel>(knightPrims, 4, BVHAccel::SplitMethod::SAH, 4, 4);
+    prims.push_back(std::make_shared<PBR::TransformedPrimitive>(knight, fbx_Object2World));
+    //prims.push_back(std::make_shared<PBR::TransformedPrimitive>(knight,
+    //    PBR::Translate(PBR::Vector3f(150.f, -200.f, -200.f)) * PBR::RotateY(30.f)));
 
     const int nTrianglesWall = 2;
     int vertexIndicesWall[nTrianglesWall * 3];
@@ -331,20 +342,23 @@ int main(int argc, char* argv[]) {
     // Meshٽṹ
     std::shared_ptr<PBR::TriangleMesh> mesh;
     std::vector<std::shared_ptr<PBR::Shape>> tris;
-    PBR::plyInfo* plyi;
+    PBR::MeshData ply;
     std::shared_ptr<Aggregate> agg;
     PBR::Transform tri_Object2World, tri_World2Object;
 
-    tri_Object2World = Translate(Vector3f(0.0, -2.9, 0.0));
+    tri_Object2World = Translate(Vector3f(0.0, -2.9, 0.0)) * Scale(20, 20, 20);
     tri_World2Object = Inverse(tri_Object2World);
 
-    plyi = new PBR::plyInfo("C:/Users/99531/Desktop/book/PBR-v1/Resources/dragon.3d");
+    std::string plyPath = "C:/Users/99531/Desktop/book/PBR-v1/Resources/dragon.ply";
+    PBR::LoadPly(plyPath, &ply);
+    int nTriangles = (int)ply.indices.size() / 3;
 
-    mesh = std::make_shared<PBR::TriangleMesh>(tri_Object2World, plyi->nTriangles, plyi->vertexIndices, plyi->nVertices, plyi->vertexArray, nullptr, nullptr, nullptr, nullptr);
-    tris.reserve(plyi->nTriangles);
-    for (int i = 0; i < plyi->nTriangles; ++i)
+    mesh = std::make_shared<PBR::TriangleMesh>(tri_Object2World, nTriangles, ply.indices.data(), (int)ply.P.size(), ply.P.data(), nullptr,
+        ply.N.empty() ? nullptr : ply.N.data(), ply.uv.empty() ? nullptr : ply.uv.data(), nullptr);
+    tris.reserve(nTriangles);
+    for (int i = 0; i < nTriangles; ++i)
         tris.push_back(std::make_shared<PBR::Triangle>(&tri_Object2World, &tri_World2Object, false, mesh, i));
-    for (int i = 0; i < plyi->nTriangles; ++i)
+    for (int i = 0; i < nTriangles; ++i)
         prims.push_back(std::make_shared<PBR::GeometricPrimitive>(tris[i], whiteGlassMaterial, nullptr, homoMediumInterface));*/
 
     //ƹ
@@ -382,7 +396,9 @@ int main(int argc, char* argv[]) {
     lights.push_back(skyBoxLight);
 
     std::shared_ptr<Aggregate> agg;
-    agg = std::make_shared<BVHAccel>(prims, 1, BVHAccel::SplitMethod::SAH);
+    // Ҷ4ͼԪԭΪ14ο飺Ҷֻ1ʱû档
+    // ıĬϳBVH״Ҫɰ汾ڵԱʱĻmaxPrimsInNode = 1triangleBlockWidth = 0
+    agg = std::make_shared<BVHAccel>(prims, 4, BVHAccel::SplitMethod::SAH, 4, 4);
 
     std::cout << "Scene created. Starting render..." << std::endl;
     //
@@ -396,21 +412,72 @@ int main(int argc, char* argv[]) {
         std::make_unique<Scene>(agg, lights);
     Bounds2i ScreenBound(Point2i(0, 0), Point2i(WIDTH, HEIGHT));
     //
-    std::shared_ptr<Integrator> integrator = std::make_shared<VolPathIntegrator>(
+    std::shared_ptr<SamplerIntegrator> integrator = std::make_shared<VolPathIntegrator>(
             10, cam, mainSampler, ScreenBound, 1.f, "uniform", framebuffer);
-    /*std::shared_ptr<Integrator> integrator = std::make_shared<PathIntegrator>(
+    /*std::shared_ptr<SamplerIntegrator> integrator = std::make_shared<PathIntegrator>(
             10, cam, mainSampler, ScreenBound, 0.8f, "uniform", framebuffer
             );*/
-    /*std::shared_ptr<Integrator> integrator = std::make_shared<WhittedIntegrator>(
+    /*std::shared_ptr<SamplerIntegrator> integrator = std::make_shared<WhittedIntegrator>(
         5, cam, mainSampler, ScreenBound, framebuffer
         );*/
-    /*std::shared_ptr<Integrator> integrator = std::make_shared<DirectLightingIntegrator>(
+    /*std::shared_ptr<SamplerIntegrator> integrator = std::make_shared<DirectLightingIntegrator>(
         LightStrategy::UniformSampleOne, 5, cam, mainSampler, ScreenBound, framebuffer
         );*/
      
+    // ʽȾÿÿ50ÿһԤ
+    integrator->SetProgressive(50, "PathTracing21_preview.png", 2);
+    // ʱȾԤʱֹͣ׷ʵɵÿ
+    //integrator->SetTimeBudget(30 * 60);
+    // ָģļĹϣsceneVersionɣԴɻԼָơ
+    // ϵֲʽȾĹ̶Ҫָһ£޸˲ʡڷŵָƸǲĳú
+    // sceneVersion1ɶϵ㼴ϣûиµĹҲᱻܾ
+    const uint64_t sceneVersion = 1;
+    uint64_t sceneHashes[3] = { PBR::FileHash(fbxPath), PBR::FileHash(plyPath), sceneVersion };
+    integrator->SetSceneFingerprint(PBR::HashBytes(sceneHashes, sizeof(sceneHashes)));
+    // ϵ֣ÿ10дһζϵ㣬жϺٴʱӶϵ
+    //integrator->SetCheckpoint("PathTracing21.ckpt", 10 * 60);
+
+    // ֲʽȾ--worker host port ΪЭߣ
+    // --distributed N ڱṆ--workerΪЭ
+    if (argc >= 4 && std::string(argv[1]) == "--worker") {
+        bool ok = integrator->RenderWorker(*worldScene, argv[2], std::stoi(argv[3]));
+        delete framebuffer;
+        return ok ? 0 : 1;
+    }
+    int nWorkers = (argc >= 3 && std::string(argv[1]) == "--distributed") ? std::stoi(argv[2]) : 0;
+
     //ʼȾ
     double frameTime;
-    integrator->Render(*worldScene, frameTime);
+    if (nWorkers > 0) {
+        Listener listener;
+        int port = listener.Listen("127.0.0.1", 0);
+        if (port < 0) {
+            std::cerr << "Failed to listen for workers." << std::endl;
+            delete framebuffer;
+            return 1;
+        }
+        // PATHʱargv[0]ֻǳʹÿִļ·
+        std::string exe = CurrentExecutable();
+        if (exe.empty()) exe = argv[0];
+        std::vector<intptr_t> processes;
+        for (int i = 0; i < nWorkers; ++i) {
+            intptr_t process = SpawnProcess(exe, { "--worker", "127.0.0.1", std::to_string(port) });
+            if (process) processes.push_back(process);
+            else std::cerr << "Failed to start worker " << i << std::endl;
+        }
+        // Эڵһǰᳬʱһ̶ûʱֱ˳
+        bool ok = !processes.empty() && integrator->RenderCoordinator(*worldScene, listener, frameTime);
+        listener.Close();
+        for (intptr_t process : processes) WaitProcess(process);
+        if (!ok) {
+            // Ƭͼ
+            std::cerr << "Distributed render failed." << std::endl;
+            delete framebuffer;
+            return 1;
+        }
+    }
+    else
+        integrator->Render(*worldScene, frameTime);
 
     std::cout << std::endl;
     std::cout << "Render finished." << std::endl;
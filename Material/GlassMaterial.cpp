@@ -7,6 +7,7 @@ namespace PBR {
 
 // GlassMaterial Method Definitions
 void GlassMaterial::ComputeScatteringFunctions(SurfaceInteraction *si,
+                                               MemoryArena &arena,
                                                TransportMode mode,
                                                bool allowMultipleLobes) const {
     float eta = index->Evaluate(*si);
@@ -14,14 +15,14 @@ void GlassMaterial::ComputeScatteringFunctions(SurfaceInteraction *si,
     float vrough = vRoughness->Evaluate(*si);
     Spectrum R = Kr->Evaluate(*si).Clamp();
     Spectrum T = Kt->Evaluate(*si).Clamp();
-    si->bsdf = std::make_shared<BSDF>(*si, eta);
+    si->bsdf = ARENA_ALLOC(arena, BSDF)(*si, eta);
 
     if (R.IsBlack() && T.IsBlack()) return;
 
     // ֲڶ
     bool isSpecular = urough == 0 && vrough == 0;
     if (isSpecular && allowMultipleLobes) {
-        si->bsdf->Add(new FresnelSpecular(R, T, 1.f, eta, mode));
+        si->bsdf->Add(ARENA_ALLOC(arena, FresnelSpecular)(R, T, 1.f, eta, mode));
     }
     // ĥɰ
 	else {
@@ -31,25 +32,25 @@ void GlassMaterial::ComputeScatteringFunctions(SurfaceInteraction *si,
         } 
         // ֲڷ - ΢ģ߹
         if (!R.IsBlack()) {
-            Fresnel *fresnel = new FresnelDielectric(1.f, eta);
+            Fresnel *fresnel = ARENA_ALLOC(arena, FresnelDielectric)(1.f, eta);
             if (isSpecular)
-                si->bsdf->Add(new SpecularReflection(R, fresnel));
+                si->bsdf->Add(ARENA_ALLOC(arena, SpecularReflection)(R, fresnel));
 			else {
 				MicrofacetDistribution *distrib =
 					isSpecular ? nullptr
-					: new TrowbridgeReitzDistribution(urough, vrough);
-				si->bsdf->Add(new MicrofacetReflection(R, distrib, fresnel));
+					: ARENA_ALLOC(arena, TrowbridgeReitzDistribution)(urough, vrough);
+				si->bsdf->Add(ARENA_ALLOC(arena, MicrofacetReflection)(R, distrib, fresnel));
 			}
         }
         // ֲ͸ - ΢ģ
         if (!T.IsBlack()) {
             if (isSpecular)
-                si->bsdf->Add(new SpecularTransmission(T, 1.f, eta, mode));
+                si->bsdf->Add(ARENA_ALLOC(arena, SpecularTransmission)(T, 1.f, eta, mode));
 			else{
 				MicrofacetDistribution *distrib =
 					isSpecular ? nullptr
-					: new TrowbridgeReitzDistribution(urough, vrough);
-				si->bsdf->Add(new MicrofacetTransmission(T, distrib, 1.f, eta, mode));
+					: ARENA_ALLOC(arena, TrowbridgeReitzDistribution)(urough, vrough);
+				si->bsdf->Add(ARENA_ALLOC(arena, MicrofacetTransmission)(T, distrib, 1.f, eta, mode));
 			}
                 
         }
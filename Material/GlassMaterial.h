@@ -24,7 +24,7 @@ class GlassMaterial : public Material {
           index(index),
           bumpMap(bumpMap),
           remapRoughness(remapRoughness) {}
-    void ComputeScatteringFunctions(SurfaceInteraction *si, 
+    void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
                                     TransportMode mode,
                                     bool allowMultipleLobes) const;
 
@@ -3,13 +3,16 @@
 #define _MATERIAL_H__
 
 #include "Core/PBR.h"
+#include "Core\Memory.h"
 
 namespace PBR {
 enum class TransportMode { Radiance, Importance };
 class Material {
   public:
     //ɢ亯
+    //BSDFBxDFarena䣬Ҫͷ
     virtual void ComputeScatteringFunctions(SurfaceInteraction *si,
+                                            MemoryArena &arena,
                                             TransportMode mode,
                                             bool allowMultipleLobes) const = 0;
     virtual ~Material() {}
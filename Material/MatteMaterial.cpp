@@ -11,19 +11,19 @@ namespace PBR {
 
     // MatteMaterial Method Definitions
     void MatteMaterial::ComputeScatteringFunctions(SurfaceInteraction* si,
-        TransportMode mode,
+        MemoryArena& arena, TransportMode mode,
         bool allowMultipleLobes) const {
         // BSDF
-        si->bsdf = std::make_shared<BSDF>(*si);
+        si->bsdf = ARENA_ALLOC(arena, BSDF)(*si);
         //ȡɫ
         Spectrum r = Kd->Evaluate(*si).Clamp();
         float sig = Clamp(sigma->Evaluate(*si), 0, 90);
         if (!r.IsBlack()) {
             //ΪBxDFģ
             if (sig == 0)
-                si->bsdf->Add(new LambertianReflection(r));
+                si->bsdf->Add(ARENA_ALLOC(arena, LambertianReflection)(r));
             else
-                si->bsdf->Add(new OrenNayar(r, sig));
+                si->bsdf->Add(ARENA_ALLOC(arena, OrenNayar)(r, sig));
         }
     }
 
@@ -13,7 +13,7 @@ namespace PBR {
             const std::shared_ptr<Texture<float>>& bumpMap)
             : Kd(Kd), sigma(sigma), bumpMap(bumpMap) {}
         void ComputeScatteringFunctions(SurfaceInteraction* si,
-            TransportMode mode,
+            MemoryArena& arena, TransportMode mode,
             bool allowMultipleLobes) const;
     private:
         std::shared_ptr<Texture<Spectrum>> Kd;
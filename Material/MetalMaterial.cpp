@@ -23,9 +23,10 @@ MetalMaterial::MetalMaterial(const std::shared_ptr<Texture<Spectrum>> &eta,
       remapRoughness(remapRoughness) {}
 
 void MetalMaterial::ComputeScatteringFunctions(SurfaceInteraction *si,
+                                               MemoryArena &arena,
                                                TransportMode mode,
                                                bool allowMultipleLobes) const {
-	si->bsdf = std::make_shared<BSDF>(*si);
+	si->bsdf = ARENA_ALLOC(arena, BSDF)(*si);
     float uRough =
         uRoughness ? uRoughness->Evaluate(*si) : roughness->Evaluate(*si);
     float vRough =
@@ -35,11 +36,11 @@ void MetalMaterial::ComputeScatteringFunctions(SurfaceInteraction *si,
         vRough = TrowbridgeReitzDistribution::RoughnessToAlpha(vRough);
     }
     //  - 
-    Fresnel *frMf = new FresnelConductor(1., eta->Evaluate(*si),
+    Fresnel *frMf = ARENA_ALLOC(arena, FresnelConductor)(1., eta->Evaluate(*si),
                                                          k->Evaluate(*si));
     // ΢
-    MicrofacetDistribution *distrib = new TrowbridgeReitzDistribution(uRough, vRough);
-    si->bsdf->Add(new MicrofacetReflection(1., distrib, frMf));
+    MicrofacetDistribution *distrib = ARENA_ALLOC(arena, TrowbridgeReitzDistribution)(uRough, vRough);
+    si->bsdf->Add(ARENA_ALLOC(arena, MicrofacetReflection)(1., distrib, frMf));
 }
 
 }
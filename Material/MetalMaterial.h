@@ -17,7 +17,7 @@ class MetalMaterial : public Material {
                   const std::shared_ptr<Texture<float>> &vrough,
                   const std::shared_ptr<Texture<float>> &bump,
                   bool remapRoughness);
-    void ComputeScatteringFunctions(SurfaceInteraction *si, 
+    void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
                                     TransportMode mode, bool allowMultipleLobes) const;
 
   private:
@@ -3,15 +3,16 @@
 
 namespace PBR {
 void MirrorMaterial::ComputeScatteringFunctions(SurfaceInteraction *si,
+                                                MemoryArena &arena,
                                                 TransportMode mode,
                                                 bool allowMultipleLobes) const {
     //if (bumpMap) Bump(bumpMap, si);
     
-	si->bsdf = std::make_shared<BSDF>(*si);
+	si->bsdf = ARENA_ALLOC(arena, BSDF)(*si);
     Spectrum R = Kr->Evaluate(*si).Clamp();
     //Ӿ淴BxDFʹ FresnelNoOp  100% 
     if (!R.IsBlack())
-        si->bsdf->Add(new SpecularReflection(R, new FresnelNoOp));
+        si->bsdf->Add(ARENA_ALLOC(arena, SpecularReflection)(R, ARENA_ALLOC(arena, FresnelNoOp)()));
     }
 }
 
@@ -15,8 +15,8 @@ class MirrorMaterial : public Material {
         Kr = r;
         bumpMap = bump;
     }
-    void ComputeScatteringFunctions(SurfaceInteraction *si, TransportMode mode,
-                                    bool allowMultipleLobes) const;
+    void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
+                                    TransportMode mode, bool allowMultipleLobes) const;
 
   private:
     std::shared_ptr<Texture<Spectrum>> Kr;
@@ -5,26 +5,26 @@
 namespace PBR {
 
 // PlasticMaterial Method Definitions
-void PlasticMaterial::ComputeScatteringFunctions(SurfaceInteraction *si, TransportMode mode,
-    bool allowMultipleLobes) const {
+void PlasticMaterial::ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
+    TransportMode mode, bool allowMultipleLobes) const {
     //if (bumpMap) Bump(bumpMap, si);
-    si->bsdf = std::make_shared<BSDF>(*si);
+    si->bsdf = ARENA_ALLOC(arena, BSDF)(*si);
     // ɫ
     Spectrum kd = Kd->Evaluate(*si).Clamp();
     if (!kd.IsBlack())
-        si->bsdf->Add(new LambertianReflection(kd));
+        si->bsdf->Add(ARENA_ALLOC(arena, LambertianReflection)(kd));
 
     // ߹
     Spectrum ks = Ks->Evaluate(*si).Clamp();
     if (!ks.IsBlack()) {
         //  - 
-        Fresnel *fresnel = new FresnelDielectric(1.5f, 1.f);
+        Fresnel *fresnel = ARENA_ALLOC(arena, FresnelDielectric)(1.5f, 1.f);
         float rough = roughness->Evaluate(*si);
         if (remapRoughness)
             rough = TrowbridgeReitzDistribution::RoughnessToAlpha(rough);
         // ΢
-        MicrofacetDistribution *distrib = new TrowbridgeReitzDistribution(rough, rough);
-        BxDF *spec = new MicrofacetReflection(ks, distrib, fresnel);
+        MicrofacetDistribution *distrib = ARENA_ALLOC(arena, TrowbridgeReitzDistribution)(rough, rough);
+        BxDF *spec = ARENA_ALLOC(arena, MicrofacetReflection)(ks, distrib, fresnel);
         si->bsdf->Add(spec);
     }
 }
@@ -20,8 +20,8 @@ class PlasticMaterial : public Material {
           roughness(roughness),
           bumpMap(bumpMap),
           remapRoughness(remapRoughness) {}
-    void ComputeScatteringFunctions(SurfaceInteraction *si, TransportMode mode,
-                                    bool allowMultipleLobes) const;
+    void ComputeScatteringFunctions(SurfaceInteraction *si, MemoryArena &arena,
+                                    TransportMode mode, bool allowMultipleLobes) const;
 
   private:
     std::shared_ptr<Texture<Spectrum>> Kd, Ks;
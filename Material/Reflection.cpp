@@ -119,7 +119,7 @@ namespace PBR{
 		int comp =
 			std::min((int)std::floor(u[0] * matchingComps), matchingComps - 1);
 		// ȡָ
-		std::shared_ptr<BxDF>bxdf = nullptr;
+		BxDF* bxdf = nullptr;
 		int count = comp;
 		for (int i = 0; i < nBxDFs; ++i)
 			if (bxdfs[i]->MatchesFlags(type) && count-- == 0) {
@@ -163,9 +163,6 @@ namespace PBR{
 		return f;
 	}
 
-	BSDF::~BSDF() {
-	}
-
 	// ䷽䷽ɢף
 	// Ϊ R / PI
 	Spectrum LambertianReflection::f(const Vector3f& wo, const Vector3f& wi) const {
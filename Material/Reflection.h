@@ -108,12 +108,9 @@ namespace PBR {
             ng(si.n),
             ss(Normalize(si.shading.dpdu)),
             ts(Cross(ns, ss)) {}
-        //עBxDF
+        //עBxDFBxDFɲʴڴз䣬BSDFָֻ
         void Add(BxDF* b) {
-            //CHECK_LT(nBxDFs, MaxBxDFs);
-            //bxdfs[nBxDFs++] = b;
-            bxdfs.push_back(std::shared_ptr<BxDF>(b));
-            nBxDFs++;
+            if (nBxDFs < MaxBxDFs) bxdfs[nBxDFs++] = b;
         }
         int NumComponents(BxDFType flags = BSDF_ALL) const;
         //ռvתΪؿռ
@@ -138,14 +135,12 @@ namespace PBR {
         float Pdf(const Vector3f& wo, const Vector3f& wi,
             BxDFType flags = BSDF_ALL) const;
         const float eta;
-        ~BSDF();
     private:
         const Normal3f ns, ng;
         const Vector3f ss, ts;
         int nBxDFs = 0;
         static constexpr int MaxBxDFs = 8;
-        std::vector<std::shared_ptr<BxDF>> bxdfs;
-        //BxDF* bxdfs[MaxBxDFs];
+        BxDF* bxdfs[MaxBxDFs];
     };
 
     //ط䣨䣩
@@ -196,7 +191,6 @@ namespace PBR {
             : BxDF(BxDFType(BSDF_REFLECTION | BSDF_SPECULAR)),
             R(R),
             fresnel(fresnel) {}
-        ~SpecularReflection() { fresnel->~Fresnel(); }
         // ䷽䷽ɢףԶΪ0
         virtual Spectrum f(const Vector3f& wo, const Vector3f& wi) const {
             return Spectrum(0.f);
@@ -272,7 +266,6 @@ namespace PBR {
             R(R),
             distribution(distribution),
             fresnel(fresnel) {}
-        ~MicrofacetReflection() {}
         Spectrum f(const Vector3f& wo, const Vector3f& wi) const;
         Spectrum Sample_f(const Vector3f& wo, Vector3f* wi, const Point2f& u,
             float* pdf, BxDFType* sampledType) const;
@@ -280,8 +273,8 @@ namespace PBR {
     private:
         // MicrofacetReflection Private Data
         const Spectrum R;
-        const std::shared_ptr<MicrofacetDistribution> distribution;
-        const std::shared_ptr<Fresnel> fresnel;
+        const MicrofacetDistribution* distribution;
+        const Fresnel* fresnel;
     };
 
     // ĥɰ΢͸䣩
@@ -297,7 +290,6 @@ namespace PBR {
             etaB(etaB),
             fresnel(etaA, etaB),
             mode(mode) {}
-        ~MicrofacetTransmission() {}
         Spectrum f(const Vector3f& wo, const Vector3f& wi) const;
         Spectrum Sample_f(const Vector3f& wo, Vector3f* wi, const Point2f& u,
             float* pdf, BxDFType* sampledType) const;
@@ -305,7 +297,7 @@ namespace PBR {
 
     private:
         const Spectrum T;
-        const std::shared_ptr<MicrofacetDistribution> distribution;
+        const MicrofacetDistribution* distribution;
         const float etaA, etaB;
         // ʷ
         const FresnelDielectric fresnel;
@@ -318,7 +310,6 @@ namespace PBR {
         // GGXĴֲڶ
         FresnelBlend(const Spectrum& Rd, const Spectrum& Rs,
             MicrofacetDistribution* distrib);
-        ~FresnelBlend() {}
         Spectrum f(const Vector3f& wo, const Vector3f& wi) const;
         // ʩ˽ƣضǶ¹߱İٷֱ
         Spectrum SchlickFresnel(float cosTheta) const {
@@ -332,7 +323,7 @@ namespace PBR {
     private:
         // ɫɫ
         const Spectrum Rd, Rs;
-        std::shared_ptr<MicrofacetDistribution> distribution;
+        const MicrofacetDistribution* distribution;
     };
 }
 
@@ -1,6 +1,10 @@
 #include "Media\GridDensityMedium.h"
 #include "Sampler\Sampler.h"
 #include "Core\interaction.h"
+#include "Core\MappedFile.h"
+#include <cstdlib>
+#include <iterator>
+#include <vector>
 
 namespace PBR {
 
@@ -21,6 +25,95 @@ float GridDensityMedium::Density(const Point3f &p) const {
 	return Lerp(d.z, d0, d1);
 }
 
+// ϽйߴһΣ[tMin, tMax]ڵܶΪmaxDensity
+struct MajorantSegment {
+	float tMin, tMax;
+	float maxDensity;
+};
+
+// 3D-DDAعηϽĵԪrayΪʿռ
+class MajorantIterator {
+public:
+	MajorantIterator(const Ray &ray, float tMin, float tMax, const float *majorants)
+		: tMin(tMin), tMax(tMax), majorants(majorants) {
+		const int res = GridDensityMedium::MajorantRes;
+		Point3f pGrid = ray(tMin) * (float)res;
+		for (int axis = 0; axis < 3; ++axis) {
+			voxel[axis] = Clamp((int)pGrid[axis], 0, res - 1);
+			float d = ray.d[axis];
+			if (d == 0) {
+				// ƽڸᣬԶһάĵԪ߽
+				nextCrossingT[axis] = Infinity;
+				deltaT[axis] = 0;
+				step[axis] = 0;
+				voxelLimit[axis] = -1;
+			}
+			else if (d > 0) {
+				deltaT[axis] = 1 / (d * res);
+				nextCrossingT[axis] = tMin + ((voxel[axis] + 1) - pGrid[axis]) / (d * res);
+				step[axis] = 1;
+				voxelLimit[axis] = res;
+			}
+			else {
+				deltaT[axis] = -1 / (d * res);
+				nextCrossingT[axis] = tMin + (voxel[axis] - pGrid[axis]) / (d * res);
+				step[axis] = -1;
+				voxelLimit[axis] = -1;
+			}
+		}
+	}
+
+	// ȡһΣ뿪򳬹tMaxʱfalse
+	bool Next(MajorantSegment *seg) {
+		if (tMin >= tMax) return false;
+		// ѡȿ߽
+		int axis = 0;
+		if (nextCrossingT[1] < nextCrossingT[axis]) axis = 1;
+		if (nextCrossingT[2] < nextCrossingT[axis]) axis = 2;
+		const int res = GridDensityMedium::MajorantRes;
+		seg->tMin = tMin;
+		seg->tMax = std::min(tMax, nextCrossingT[axis]);
+		seg->maxDensity = majorants[(voxel[2] * res + voxel[1]) * res + voxel[0]];
+		tMin = seg->tMax;
+		if (nextCrossingT[axis] > tMax) tMin = tMax;
+		voxel[axis] += step[axis];
+		if (voxel[axis] == voxelLimit[axis]) tMin = tMax;
+		nextCrossingT[axis] += deltaT[axis];
+		return true;
+	}
+
+private:
+	float tMin, tMax;
+	const float *majorants;
+	float nextCrossingT[3], deltaT[3];
+	int voxel[3], step[3], voxelLimit[3];
+};
+
+void GridDensityMedium::BuildMajorantGrid() {
+	const int res = MajorantRes;
+	majorants.reset(new float[res * res * res]);
+	for (int z = 0; z < res; ++z)
+		for (int y = 0; y < res; ++y)
+			for (int x = 0; x < res; ++x) {
+				// Ԫ[x/res, (x+1)/res]ڵĵԲֵʱ
+				// õfloor(p*n-0.5)floor(p*n-0.5)+1
+				int x0 = std::max((int)std::floor((float)x / res * nx - .5f), 0);
+				int x1 = std::min((int)std::floor((float)(x + 1) / res * nx - .5f) + 1, nx - 1);
+				int y0 = std::max((int)std::floor((float)y / res * ny - .5f), 0);
+				int y1 = std::min((int)std::floor((float)(y + 1) / res * ny - .5f) + 1, ny - 1);
+				int z0 = std::max((int)std::floor((float)z / res * nz - .5f), 0);
+				int z1 = std::min((int)std::floor((float)(z + 1) / res * nz - .5f) + 1, nz - 1);
+				// ȡЩڿܶȣտ鲻÷
+				const int bs = SparseDensityGrid::BrickSize;
+				float maxDensity = 0;
+				for (int bz = z0 / bs; bz <= z1 / bs; ++bz)
+					for (int by = y0 / bs; by <= y1 / bs; ++by)
+						for (int bx = x0 / bs; bx <= x1 / bs; ++bx)
+							maxDensity = std::max(maxDensity, grid->BrickMax(bx, by, bz));
+				majorants[(z * res + y) * res + x] = maxDensity;
+			}
+}
+
 Spectrum GridDensityMedium::Sample(const Ray &rWorld, Sampler &sampler, MediumInteraction *mi) const {
 	Ray ray = WorldToMedium(
 		Ray(rWorld.o, Normalize(rWorld.d), rWorld.tMax * rWorld.d.Length()));
@@ -29,17 +122,23 @@ Spectrum GridDensityMedium::Sample(const Ray &rWorld, Sampler &sampler, MediumIn
 	float tMin, tMax;
 	if (!b.IntersectP(ray, &tMin, &tMax)) return Spectrum(1.f);
 
-	// Run delta-tracking iterations to sample a medium interaction
-	float t = tMin;
-	while (true) {
-		t -= std::log(1 - sampler.Get1D()) * invMaxDensity / sigma_t;
-		if (t >= tMax) break;
-		if (Density(ray(t)) * invMaxDensity > sampler.Get1D()) {
-			// Populate _mi_ with medium interaction information and return
-			PhaseFunction *phase = new HenyeyGreenstein(g);
-			*mi = MediumInteraction(rWorld(t), -rWorld.d, rWorld.time, this,
-				phase);
-			return sigma_s / sigma_t;
+	// Ͻ絥Ԫdelta trackingֲָ޼䣬ڵԪ߽紦¿ʼ
+	MajorantIterator iter(ray, tMin, tMax, majorants.get());
+	MajorantSegment seg;
+	while (iter.Next(&seg)) {
+		// յԪвᷢײ
+		if (seg.maxDensity == 0) continue;
+		float invMaxDensity = 1 / seg.maxDensity;
+		float t = seg.tMin;
+		while (true) {
+			t -= std::log(1 - sampler.Get1D()) * invMaxDensity / sigma_t;
+			if (t >= seg.tMax) break;
+			if (Density(ray(t)) * invMaxDensity > sampler.Get1D()) {
+				// Populate _mi_ with medium interaction information and return
+				*mi = MediumInteraction(rWorld(t), -rWorld.d, rWorld.time, this,
+					&phase);
+				return sigma_s / sigma_t;
+			}
 		}
 	}
 	return Spectrum(1.f);
@@ -54,30 +153,89 @@ Spectrum GridDensityMedium::Tr(const Ray &rWorld, Sampler &sampler) const {
 	if (!b.IntersectP(ray, &tMin, &tMax)) return Spectrum(1.f);
 
 	// Perform ratio tracking to estimate the transmittance value
-	float Tr = 1, t = tMin;
-
-	while (true) {
-		t -= std::log(1 - sampler.Get1D()) * invMaxDensity / sigma_t;
-		if (t >= tMax) break;
-		float density = Density(ray(t));
-		Tr *= 1 - std::max((float)0, density * invMaxDensity);
-		// Added after book publication: when transmittance gets low,
-		// start applying Russian roulette to terminate sampling.
-		const float rrThreshold = .1;
-		if (Tr < rrThreshold) {
-			float q = std::max((float).05, 1 - Tr);
-			if (sampler.Get1D() < q) return 0;
-			Tr /= 1 - q;
+	// ͬϽ絥ԪУյԪ͸Ϊ1
+	float Tr = 1;
+	MajorantIterator iter(ray, tMin, tMax, majorants.get());
+	MajorantSegment seg;
+	while (iter.Next(&seg)) {
+		if (seg.maxDensity == 0) continue;
+		float invMaxDensity = 1 / seg.maxDensity;
+		float t = seg.tMin;
+		while (true) {
+			t -= std::log(1 - sampler.Get1D()) * invMaxDensity / sigma_t;
+			if (t >= seg.tMax) break;
+			float density = Density(ray(t));
+			Tr *= 1 - std::max((float)0, density * invMaxDensity);
+			// Added after book publication: when transmittance gets low,
+			// start applying Russian roulette to terminate sampling.
+			const float rrThreshold = .1;
+			if (Tr < rrThreshold) {
+				float q = std::max((float).05, 1 - Tr);
+				if (sampler.Get1D() < q) return 0;
+				Tr /= 1 - q;
+			}
 		}
 	}
 	return Spectrum(Tr);
 }
 
-
-
-
+MediumLoad::MediumLoad(std::string name, const Transform &medium2world, bool quantize) {
+	std::ifstream f(name);
+	std::string ed;
+	f >> ed; f >> nx;
+	f >> ed; f >> ny;
+	f >> ed; f >> nz;
+	Point3f p0; Point3f p1;
+	f >> ed; f >> p0.x; f >> p0.y; f >> p0.z;
+	f >> ed; f >> p1.x; f >> p1.y; f >> p1.z;
+
+	// Ԥ
+	float sig_a_rgb[3], sig_s_rgb[3];
+	f >> ed; f >> sig_a_rgb[0]; f >> sig_a_rgb[1]; f >> sig_a_rgb[2];
+	f >> ed; f >> sig_s_rgb[0]; f >> sig_s_rgb[1]; f >> sig_s_rgb[2];
+
+	Spectrum sig_a = Spectrum::FromRGB(sig_a_rgb), sig_s = 0.2 * Spectrum::FromRGB(sig_s_rgb);
+	float g = -0.5f;
+
+	// ʹöƻ棺¼ .vol ޸ʱʹС뵱ǰһ¡ֱʺʹ洢ʽһ
+	std::string cacheName = name + ".bricks";
+	long long sourceTime = FileModifiedTime(name), sourceSize = FileSize(name);
+	std::shared_ptr<const SparseDensityGrid> grid;
+	std::shared_ptr<SparseDensityGrid> cached = SparseDensityGrid::Load(cacheName);
+	if (cached && cached->SourceTime() == sourceTime && cached->SourceSize() == sourceSize &&
+		cached->Nx() == nx && cached->Ny() == ny && cached->Nz() == nz &&
+		cached->Quantized() == quantize)
+		grid = cached;
+	// õľɻȽӳ䣬Windows޷滻ļ
+	cached = nullptr;
+	bool fromCache = (bool)grid;
+	if (!grid) {
+		// һζʣıstrtofoperator>>ö
+		std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+		std::vector<float> data((size_t)nx * ny * nz, 0.f);
+		const char *p = text.c_str();
+		for (size_t i = 0; i < data.size(); i++) {
+			char *end;
+			data[i] = std::strtof(p, &end);
+			if (end == p) break;
+			p = end;
+		}
+		std::shared_ptr<SparseDensityGrid> built =
+			std::make_shared<SparseDensityGrid>(nx, ny, nz, data.data(), quantize);
+		if (!built->Write(cacheName, sourceTime, sourceSize))
+			std::cout << "MediumLoad: can't write cache " << cacheName << std::endl;
+		grid = built;
+	}
+	f.close();
+	std::cout << "MediumLoad: " << nx << "x" << ny << "x" << nz << ", "
+		<< grid->BrickCount() << "/" << grid->BrickTotal() << " bricks, "
+		<< grid->Bytes() / (1024.0 * 1024.0) << " MB"
+		<< (fromCache ? ", from cache" : "") << std::endl;
+
+	Transform data2Medium = Translate(Vector3f(p0)) *
+		Scale(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+	med = std::make_shared<GridDensityMedium>(sig_a, sig_s, g, grid,
+		medium2world * data2Medium);
 }
 
-
-
-
+}
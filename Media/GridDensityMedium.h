@@ -1,5 +1,6 @@
 #pragma once
 #include "Media\Medium.h"
+#include "Media\SparseDensityGrid.h"
 #include "Core\PBR.h"
 #include "Core\Transform.h"
 #include "Core\Spectrum.h"
@@ -14,38 +15,36 @@ class GridDensityMedium : public Medium {
 public:
 	// һܶ3DĿռнй׷
 	GridDensityMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, float g,
-		int nx, int ny, int nz, const Transform &mediumToWorld,
-		const float *d)
+		const std::shared_ptr<const SparseDensityGrid> &grid, const Transform &mediumToWorld)
 		: sigma_a(sigma_a), // ϵ
 		sigma_s(sigma_s), // ɢϵ
-		g(g), // ƹɢķ
-		nx(nx),
-		ny(ny),
-		nz(nz), // 
+		phase(g), // λgƹɢķ
+		nx(grid->Nx()),
+		ny(grid->Ny()),
+		nz(grid->Nz()), // 
 		WorldToMedium(Inverse(mediumToWorld)), // 굽ʾֲ꣬ߴʱȾҪѯĳһڽеľֲλ
-		density(new float[nx * ny * nz]) {
-		memcpy((float *)density.get(), d, sizeof(float) * nx * ny * nz);
+		grid(grid) {
 		// Precompute values for Monte Carlo sampling of _GridDensityMedium_
 		sigma_t = (sigma_a + sigma_s)[0];
 		if (Spectrum(sigma_t) != sigma_a + sigma_s) {
 			//
 		}
-		float maxDensity = 0;
-		for (int i = 0; i < nx * ny * nz; ++i)
-			maxDensity = std::max(maxDensity, density[i]);
-		invMaxDensity = 1.f / maxDensity;
+		BuildMajorantGrid();
 	}
+	// ɳdϡquantizeΪtrueʱܶ16λ洢
+	GridDensityMedium(const Spectrum &sigma_a, const Spectrum &sigma_s, float g,
+		int nx, int ny, int nz, const Transform &mediumToWorld,
+		const float *d, bool quantize = false)
+		: GridDensityMedium(sigma_a, sigma_s, g,
+			std::make_shared<SparseDensityGrid>(nx, ny, nz, d, quantize), mediumToWorld) {}
 
 	// һ pתΪʾֲ꣬
 	//  density нԲֵһƽֵܶ
 	float Density(const Point3f &p) const;
 
 
-	float D(const Point3i &p) const {
-		Bounds3i sampleBounds(Point3i(0, 0, 0), Point3i(nx, ny, nz));
-		if (!InsideExclusive(p, sampleBounds)) return 0;
-		return density[(p.z * ny + p.y) * nx + p.x];
-	}
+	// ܶȣϡĿ
+	float D(const Point3i &p) const { return grid->D(p); }
 
 	// ģ ray ڽеĴ
 	// ǷԼʷһεײ
@@ -54,48 +53,30 @@ public:
 	// ͸
 	Spectrum Tr(const Ray &ray, Sampler &sampler) const;
 
+	// ȵϽÿһάMajorantResԪǽʿռ[0,1]^3
+	static const int MajorantRes = 16;
+
 private:
+	// ͳÿϽ絥ԪԲֵȡܶ
+	void BuildMajorantGrid();
+
 	const Spectrum sigma_a, sigma_s;
-	const float g;
+	// ʹһλɢ¼ֻ
+	const HenyeyGreenstein phase;
 	const int nx, ny, nz;
 	const Transform WorldToMedium;
-	std::unique_ptr<float[]> density;
+	std::shared_ptr<const SparseDensityGrid> grid;
 	float sigma_t;
-	float invMaxDensity;
+	// ÿԪľֲܶȣdelta/ratio trackingڵԪڰΪ0ĵԪֱ
+	std::unique_ptr<float[]> majorants;
 };
 
-// ضʽ .volȷعһ GridDensityMedium ʵ任
+// ضʽ .volȷعһ GridDensityMedium ʵ任
+// ܶݵһμغдͬĿ¼µ name.bricks ƻ棬
+// ֻ֮Ҫ .vol £ֱڴӳ仺ٽı
 class MediumLoad {
 public:
-	MediumLoad(std::string name, const Transform &medium2world) {
-		std::fstream f(name);
-		std::string ed;
-		f >> ed; f >> nx;
-		f >> ed; f >> ny;
-		f >> ed; f >> nz;
-		Point3f p0; Point3f p1;
-		f >> ed; f >> p0.x; f >> p0.y; f >> p0.z;
-		f >> ed; f >> p1.x; f >> p1.y; f >> p1.z;
-		
-		// Ԥ
-		float sig_a_rgb[3], sig_s_rgb[3];
-		f >> ed; f >> sig_a_rgb[0]; f >> sig_a_rgb[1]; f >> sig_a_rgb[2];
-		f >> ed; f >> sig_s_rgb[0]; f >> sig_s_rgb[1]; f >> sig_s_rgb[2];
-
-		Spectrum sig_a = Spectrum::FromRGB(sig_a_rgb), sig_s = 0.2 * Spectrum::FromRGB(sig_s_rgb);
-		float g = -0.5f;
-
-		float *data = new float[nx * ny * nz];
-		for (int i = 0; i < nx*ny*nz; i++) {
-			f >> data[i];
-		}
-		Transform data2Medium = Translate(Vector3f(p0)) *
-			Scale(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
-		med = std::make_shared<GridDensityMedium>(sig_a, sig_s, g, nx, ny, nz,
-			medium2world * data2Medium, data);
-		f.close();
-		delete[] data;
-	}
+	MediumLoad(std::string name, const Transform &medium2world, bool quantize = false);
 	std::shared_ptr<Medium> med;
 	int nx, ny, nz;
 
@@ -23,7 +23,7 @@ Spectrum HomogeneousMedium::Sample(const Ray &ray, Sampler &sampler,
     bool sampledMedium = t < ray.tMax;
     if (sampledMedium)
         *mi = MediumInteraction(ray(t), -ray.d, ray.time, this,
-                                new HenyeyGreenstein(g));
+                                &phase);
 
     // ڽɢ䣬
     Spectrum Tr = Exp(-sigma_t * std::min(t, MaxFloat) * ray.d.Length());
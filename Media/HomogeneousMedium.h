@@ -16,7 +16,7 @@ namespace PBR {
 			: sigma_a(sigma_a),
 			sigma_s(sigma_s),
 			sigma_t(sigma_s + sigma_a),
-			g(g) {}
+			phase(g) {}
 		// ͸
 		Spectrum Tr(const Ray &ray, Sampler &sampler) const;
 		// ڹ ray ·һɢ
@@ -24,7 +24,8 @@ namespace PBR {
 			MediumInteraction *mi) const;
 	private:
 		const Spectrum sigma_a, sigma_s, sigma_t;
-		const float g;
+		// ʹһλɢ¼ֻ
+		const HenyeyGreenstein phase;
 	};
 
 
@@ -0,0 +1,172 @@
+#include "Media\SparseDensityGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace PBR {
+
+// ļͷ
+struct SparseDensityGridHeader {
+	char magic[8];
+	uint32_t version;
+	int32_t nx, ny, nz;
+	uint32_t quantized;
+	uint32_t nBricks;
+	uint32_t reserved[2];
+	// ɻԴļ޸ʱСWriteд
+	int64_t sourceTime;
+	int64_t sourceSize;
+};
+
+static const char GridMagic[8] = { 'P', 'B', 'R', 'B', 'R', 'I', 'C', 'K' };
+// 汾2ļͷмԴļ޸ʱС
+static const uint32_t GridVersion = 2;
+static const int BrickVoxels = SparseDensityGrid::BrickSize * SparseDensityGrid::BrickSize *
+	SparseDensityGrid::BrickSize;
+
+SparseDensityGrid::SparseDensityGrid(int nx, int ny, int nz, const float *d, bool quantize) {
+	const int bs = BrickSize;
+	int nbx = (nx + bs - 1) / bs, nby = (ny + bs - 1) / bs, nbz = (nz + bs - 1) / bs;
+	int nTotal = nbx * nby * nbz;
+
+	// һ飺ҳǿտ鲢ͳÿܶȷΧ
+	std::vector<uint32_t> index(nTotal, EmptyBrick);
+	std::vector<float> range;
+	for (int bz = 0; bz < nbz; ++bz)
+		for (int by = 0; by < nby; ++by)
+			for (int bx = 0; bx < nbx; ++bx) {
+				float minD = Infinity, maxD = -Infinity;
+				bool empty = true;
+				for (int z = bz * bs; z < std::min((bz + 1) * bs, nz); ++z)
+					for (int y = by * bs; y < std::min((by + 1) * bs, ny); ++y)
+						for (int x = bx * bs; x < std::min((bx + 1) * bs, nx); ++x) {
+							float v = d[(z * ny + y) * nx + x];
+							if (v != 0) empty = false;
+							minD = std::min(minD, v);
+							maxD = std::max(maxD, v);
+						}
+				if (empty) continue;
+				// 鳬Ĳְ0
+				if ((bx + 1) * bs > nx || (by + 1) * bs > ny || (bz + 1) * bs > nz) {
+					minD = std::min(minD, 0.f);
+					maxD = std::max(maxD, 0.f);
+				}
+				index[(bz * nby + by) * nbx + bx] = (uint32_t)(range.size() / 2);
+				range.push_back(minD);
+				range.push_back(maxD);
+			}
+	int nBricks = (int)(range.size() / 2);
+
+	// ļʽŲbuffer
+	size_t voxelBytes = quantize ? sizeof(uint16_t) : sizeof(float);
+	size_t size = sizeof(SparseDensityGridHeader) + nTotal * sizeof(uint32_t) +
+		range.size() * sizeof(float) + (size_t)nBricks * BrickVoxels * voxelBytes;
+	buffer.assign(size, 0);
+	SparseDensityGridHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, GridMagic, sizeof(GridMagic));
+	header.version = GridVersion;
+	header.nx = nx;
+	header.ny = ny;
+	header.nz = nz;
+	header.quantized = quantize ? 1 : 0;
+	header.nBricks = nBricks;
+	header.sourceTime = -1;
+	header.sourceSize = -1;
+	char *p = buffer.data();
+	memcpy(p, &header, sizeof(header));
+	p += sizeof(header);
+	memcpy(p, index.data(), nTotal * sizeof(uint32_t));
+	p += nTotal * sizeof(uint32_t);
+	memcpy(p, range.data(), range.size() * sizeof(float));
+	p += range.size() * sizeof(float);
+
+	// ڶ飺дݣڰzyx˳
+	float *fData = (float *)p;
+	uint16_t *qData = (uint16_t *)p;
+	for (int bz = 0; bz < nbz; ++bz)
+		for (int by = 0; by < nby; ++by)
+			for (int bx = 0; bx < nbx; ++bx) {
+				uint32_t b = index[(bz * nby + by) * nbx + bx];
+				if (b == EmptyBrick) continue;
+				float minD = range[2 * b], maxD = range[2 * b + 1];
+				float invScale = maxD > minD ? 65535.f / (maxD - minD) : 0;
+				for (int z = 0; z < bs; ++z)
+					for (int y = 0; y < bs; ++y)
+						for (int x = 0; x < bs; ++x) {
+							int vx = bx * bs + x, vy = by * bs + y, vz = bz * bs + z;
+							float v = (vx < nx && vy < ny && vz < nz) ? d[(vz * ny + vy) * nx + vx] : 0;
+							size_t o = (size_t)b * BrickVoxels + (z * bs + y) * bs + x;
+							if (quantize)
+								qData[o] = (uint16_t)Clamp(std::round((v - minD) * invScale), 0, 65535);
+							else
+								fData[o] = v;
+						}
+			}
+	setPointers(buffer.data(), buffer.size());
+}
+
+bool SparseDensityGrid::setPointers(const char *base, size_t size) {
+	if (size < sizeof(SparseDensityGridHeader)) return false;
+	SparseDensityGridHeader header;
+	memcpy(&header, base, sizeof(header));
+	if (memcmp(header.magic, GridMagic, sizeof(GridMagic)) != 0 || header.version != GridVersion)
+		return false;
+	if (header.nx <= 0 || header.ny <= 0 || header.nz <= 0) return false;
+	const int bs = BrickSize;
+	nx = header.nx;
+	ny = header.ny;
+	nz = header.nz;
+	nbx = (nx + bs - 1) / bs;
+	nby = (ny + bs - 1) / bs;
+	nbz = (nz + bs - 1) / bs;
+	if (header.nBricks > (uint32_t)std::numeric_limits<int>::max()) return false;
+	nBricks = (int)header.nBricks;
+	quantized = header.quantized != 0;
+	size_t nTotal = (size_t)nbx * nby * nbz;
+	size_t voxelBytes = quantized ? sizeof(uint16_t) : sizeof(float);
+	size_t expected = sizeof(SparseDensityGridHeader) + nTotal * sizeof(uint32_t) +
+		(size_t)nBricks * 2 * sizeof(float) + (size_t)nBricks * BrickVoxels * voxelBytes;
+	if (size != expected) return false;
+
+	const char *p = base + sizeof(SparseDensityGridHeader);
+	brickIndex = (const uint32_t *)p;
+	// ָеĿ飬𻵵ļD()Խȡ
+	for (size_t i = 0; i < nTotal; ++i)
+		if (brickIndex[i] != EmptyBrick && brickIndex[i] >= header.nBricks) {
+			brickIndex = nullptr;
+			return false;
+		}
+	p += nTotal * sizeof(uint32_t);
+	brickRange = (const float *)p;
+	p += (size_t)nBricks * 2 * sizeof(float);
+	floatData = quantized ? nullptr : (const float *)p;
+	quantData = quantized ? (const uint16_t *)p : nullptr;
+	sourceTime = header.sourceTime;
+	sourceSize = header.sourceSize;
+	bytes = size;
+	return true;
+}
+
+std::shared_ptr<SparseDensityGrid> SparseDensityGrid::Load(const std::string &filename) {
+	std::shared_ptr<SparseDensityGrid> grid(new SparseDensityGrid());
+	if (!grid->file.Open(filename)) return nullptr;
+	if (!grid->setPointers(grid->file.Data(), grid->file.Size())) return nullptr;
+	return grid;
+}
+
+bool SparseDensityGrid::Write(const std::string &filename, long long sourceTime,
+	long long sourceSize) const {
+	const char *base = buffer.empty() ? file.Data() : buffer.data();
+	SparseDensityGridHeader header;
+	memcpy(&header, base, sizeof(header));
+	header.sourceTime = sourceTime;
+	header.sourceSize = sourceSize;
+	// дʱļ滻дһ뱻Ҳ²Ļ
+	AtomicFileWriter f(filename);
+	return f.Write(&header, sizeof(header)) &&
+		f.Write(base + sizeof(header), bytes - sizeof(header)) && f.Commit();
+}
+
+}
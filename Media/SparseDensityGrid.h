@@ -0,0 +1,83 @@
+#pragma once
+#ifndef __SparseDensityGrid_h__
+#define __SparseDensityGrid_h__
+
+#include "Core\PBR.h"
+#include "Core\Geometry.h"
+#include "Core\MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PBR {
+
+// ϡܶذBrickSize^3ֿ飨brickȫΪ0Ŀ鲻洢
+// ͨңѡѿΪ16λԿڵ[min, max]
+// ڴ沼ϵĶƸʽȫͬ
+//   Header | uint32 [nbx*nby*nbz] | float 鷶Χ[2*nBricks] | 
+// ˼ȿɳ鹹Ҳֱڴӳļʹ
+class SparseDensityGrid {
+public:
+	static const int BrickSize = 8;
+	// бʾտ
+	static const uint32_t EmptyBrick = 0xffffffff;
+
+	// ɳܵnx*ny*nz鹹quantizeΪtrueʱ16λ洢
+	SparseDensityGrid(int nx, int ny, int nz, const float *d, bool quantize = false);
+	// ڴӳļʽ汾ݲԽʱnullptr
+	static std::shared_ptr<SparseDensityGrid> Load(const std::string &filename);
+	// ԭӵдļļͷм¼Դļ޸ʱС
+	bool Write(const std::string &filename, long long sourceTime, long long sourceSize) const;
+
+	// pܶȣΪ0BrickSizeΪ8±ֱλ
+	float D(const Point3i &p) const {
+		if (p.x < 0 || p.y < 0 || p.z < 0 || p.x >= nx || p.y >= ny || p.z >= nz) return 0;
+		uint32_t b = brickIndex[((p.z >> 3) * nby + (p.y >> 3)) * nbx + (p.x >> 3)];
+		if (b == EmptyBrick) return 0;
+		size_t o = ((size_t)b << 9) + (((p.z & 7) << 6) | ((p.y & 7) << 3) | (p.x & 7));
+		if (!quantized) return floatData[o];
+		float minD = brickRange[2 * b], maxD = brickRange[2 * b + 1];
+		return minD + quantData[o] * ((maxD - minD) * (1.f / 65535.f));
+	}
+	// (bx, by, bz)ڵܶȣտΪ0
+	float BrickMax(int bx, int by, int bz) const {
+		uint32_t b = brickIndex[(bz * nby + by) * nbx + bx];
+		return b == EmptyBrick ? 0 : brickRange[2 * b + 1];
+	}
+
+	int Nx() const { return nx; }
+	int Ny() const { return ny; }
+	int Nz() const { return nz; }
+	int BrickCount() const { return nBricks; }
+	int BrickTotal() const { return nbx * nby * nbz; }
+	bool Quantized() const { return quantized; }
+	// ռõֽӳļʱΪļС
+	size_t Bytes() const { return bytes; }
+	// Ļļ¼Դļ޸ʱСɳ鹹ʱΪ-1
+	long long SourceTime() const { return sourceTime; }
+	long long SourceSize() const { return sourceSize; }
+
+private:
+	SparseDensityGrid() {}
+	// ʼַøָ룬ݲʱfalse
+	bool setPointers(const char *base, size_t size);
+
+	int nx = 0, ny = 0, nz = 0;
+	int nbx = 0, nby = 0, nbz = 0;
+	int nBricks = 0;
+	bool quantized = false;
+	size_t bytes = 0;
+	long long sourceTime = -1, sourceSize = -1;
+	const uint32_t *brickIndex = nullptr;
+	const float *brickRange = nullptr;
+	const float *floatData = nullptr;
+	const uint16_t *quantData = nullptr;
+	// ݴbufferɳ鹹fileڴӳ䣩
+	std::vector<char> buffer;
+	MappedFile file;
+};
+
+}
+
+#endif
@@ -26,6 +26,9 @@ class Sampler {
     const Point2f *Get2DArray(int n);
     virtual bool StartNextSample();
     virtual std::unique_ptr<Sampler> Clone(int seed) = 0;
+    // ͬһȾһʱStartPixel֮ǰã
+    // ЧClone(seed)õ²ͬӵĲʵ
+    virtual void Reseed(int seed) {}
     virtual bool SetSampleNumber(int64_t sampleNum);
 
     int64_t CurrentSampleNumber() const { return currentPixelSampleIndex; }
@@ -50,6 +53,7 @@ public:
 	bool SetSampleNumber(int64_t);
 	float Get1D();
 	Point2f Get2D();
+	void Reseed(int seed) { rng.SetSequence(seed); }
 
 protected:
 	std::vector<std::vector<float>> samples1D;
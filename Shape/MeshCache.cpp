@@ -0,0 +1,145 @@
+#include "Shape\MeshCache.h"
+#include <cstring>
+
+namespace PBR {
+
+	// ļͷnMeshesMeshRecord֮Ǹݣ
+	// ֣뵽4ֽڣ| P | Nѡ| uvѡ| 
+	struct MeshCacheHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t nMeshes;
+		uint64_t sourceHash;
+		int64_t sourceTime;
+		uint64_t sourceSize;
+	};
+
+	struct MeshRecord {
+		uint64_t offset;
+		uint32_t nVertices, nTriangles;
+		uint32_t nameLength;
+		uint32_t hasNormals, hasUV;
+		uint32_t reserved;
+	};
+
+	static const char MeshCacheMagic[8] = { 'P', 'B', 'R', 'M', 'E', 'S', 'H', 0 };
+	// aiProcess_Triangulateʽ仯ʱӰ汾ţɻԶʧЧ
+	static const uint32_t MeshCacheVersion = 1;
+
+	static inline size_t align4(size_t n) { return (n + 3) & ~(size_t)3; }
+
+	// ļռõֽ
+	static size_t meshBytes(const MeshRecord& rec) {
+		return align4(rec.nameLength) + rec.nVertices * sizeof(Point3f) +
+			(rec.hasNormals ? rec.nVertices * sizeof(Normal3f) : 0) +
+			(rec.hasUV ? rec.nVertices * sizeof(Point2f) : 0) +
+			(size_t)rec.nTriangles * 3 * sizeof(int);
+	}
+
+	bool MeshCache::Open(const std::string& cacheName, const std::string& source) {
+		meshes.clear();
+		if (!file.Open(cacheName)) return false;
+		const char* base = file.Data();
+		size_t size = file.Size();
+		MeshCacheHeader header;
+		if (size < sizeof(header)) return false;
+		memcpy(&header, base, sizeof(header));
+		if (memcmp(header.magic, MeshCacheMagic, sizeof(MeshCacheMagic)) != 0 ||
+			header.version != MeshCacheVersion)
+			return false;
+
+		// ȱȽ޸ʱ䣬һʱٶԴļ
+		if (header.sourceTime != FileModifiedTime(source)) return false;
+		MappedFile sourceFile;
+		if (!sourceFile.Open(source) || sourceFile.Size() != header.sourceSize ||
+			HashBytes(sourceFile.Data(), sourceFile.Size()) != header.sourceHash)
+			return false;
+
+		size_t tableEnd = sizeof(header) + (size_t)header.nMeshes * sizeof(MeshRecord);
+		if (size < tableEnd) return false;
+		const MeshRecord* records = (const MeshRecord*)(base + sizeof(header));
+		meshes.reserve(header.nMeshes);
+		for (uint32_t i = 0; i < header.nMeshes; ++i) {
+			const MeshRecord& rec = records[i];
+			if (rec.offset < tableEnd || rec.offset + meshBytes(rec) > size) {
+				meshes.clear();
+				return false;
+			}
+			const char* p = base + rec.offset;
+			CachedMesh mesh;
+			mesh.name.assign(p, rec.nameLength);
+			p += align4(rec.nameLength);
+			mesh.nVertices = (int)rec.nVertices;
+			mesh.nTriangles = (int)rec.nTriangles;
+			mesh.P = (const Point3f*)p;
+			p += rec.nVertices * sizeof(Point3f);
+			mesh.N = nullptr;
+			if (rec.hasNormals) {
+				mesh.N = (const Normal3f*)p;
+				p += rec.nVertices * sizeof(Normal3f);
+			}
+			mesh.uv = nullptr;
+			if (rec.hasUV) {
+				mesh.uv = (const Point2f*)p;
+				p += rec.nVertices * sizeof(Point2f);
+			}
+			mesh.indices = (const int*)p;
+			// ԽĻTriangleMeshԽȡ㣬
+			for (size_t j = 0; j < (size_t)rec.nTriangles * 3; ++j)
+				if ((uint32_t)mesh.indices[j] >= rec.nVertices) {
+					meshes.clear();
+					return false;
+				}
+			meshes.push_back(mesh);
+		}
+		return true;
+	}
+
+	bool MeshCache::Write(const std::string& cacheName, const std::string& source,
+		const std::vector<MeshData>& meshes) {
+		MappedFile sourceFile;
+		if (!sourceFile.Open(source)) return false;
+		MeshCacheHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, MeshCacheMagic, sizeof(MeshCacheMagic));
+		header.version = MeshCacheVersion;
+		header.nMeshes = (uint32_t)meshes.size();
+		header.sourceHash = HashBytes(sourceFile.Data(), sourceFile.Size());
+		header.sourceTime = FileModifiedTime(source);
+		header.sourceSize = sourceFile.Size();
+
+		std::vector<MeshRecord> records(meshes.size());
+		uint64_t offset = sizeof(header) + meshes.size() * sizeof(MeshRecord);
+		for (size_t i = 0; i < meshes.size(); ++i) {
+			MeshRecord& rec = records[i];
+			memset(&rec, 0, sizeof(rec));
+			rec.offset = offset;
+			rec.nVertices = (uint32_t)meshes[i].P.size();
+			rec.nTriangles = (uint32_t)(meshes[i].indices.size() / 3);
+			rec.nameLength = (uint32_t)meshes[i].name.size();
+			rec.hasNormals = meshes[i].N.empty() ? 0 : 1;
+			rec.hasUV = meshes[i].uv.empty() ? 0 : 1;
+			offset += meshBytes(rec);
+		}
+
+		// ֲ̣ʽȾḶ́ӳžɻ棬ܽضϺԭд
+		// дʱļ滻
+		AtomicFileWriter f(cacheName);
+		if (!f.Write(&header, sizeof(header)) ||
+			!f.Write(records.data(), records.size() * sizeof(MeshRecord)))
+			return false;
+		const char zeros[4] = { 0, 0, 0, 0 };
+		for (size_t i = 0; i < meshes.size(); ++i) {
+			const MeshData& mesh = meshes[i];
+			if (!f.Write(mesh.name.data(), mesh.name.size()) ||
+				!f.Write(zeros, align4(mesh.name.size()) - mesh.name.size()) ||
+				!f.Write(mesh.P.data(), mesh.P.size() * sizeof(Point3f)) ||
+				!f.Write(mesh.N.data(), mesh.N.size() * sizeof(Normal3f)) ||
+				!f.Write(mesh.uv.data(), mesh.uv.size() * sizeof(Point2f)) ||
+				!f.Write(mesh.indices.data(), records[i].nTriangles * 3 * sizeof(int)))
+				return false;
+		}
+		return f.Commit();
+	}
+
+}
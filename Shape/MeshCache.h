@@ -0,0 +1,53 @@
+#pragma once
+#ifndef __MeshCache_h__
+#define __MeshCache_h__
+
+#include "Core\PBR.h"
+#include "Core\Geometry.h"
+#include "Core\MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PBR {
+
+	// һռ䣩д뻺
+	struct MeshData {
+		std::string name;
+		std::vector<Point3f> P;
+		std::vector<Normal3f> N;
+		std::vector<Point2f> uv;
+		std::vector<int> indices;
+	};
+
+	// еһֱָָӳļûз߻UVʱΪnullptr
+	struct CachedMesh {
+		std::string name;
+		int nVertices, nTriangles;
+		const Point3f* P;
+		const Normal3f* N;
+		const Point2f* uv;
+		const int* indices;
+	};
+
+	// ģ͵Ķ񻺴棺ռĶ㡢ߡUV
+	// Դļ޸ʱ䡢СݹϣУ飬ȡʱڴӳļ
+	class MeshCache {
+	public:
+		// 򿪻cacheNameԴļsourceĶ򻺴ʽʱfalse
+		bool Open(const std::string& cacheName, const std::string& source);
+		int MeshCount() const { return (int)meshes.size(); }
+		const CachedMesh& Mesh(int i) const { return meshes[i]; }
+
+		// ΪԴļsourceд
+		static bool Write(const std::string& cacheName, const std::string& source,
+			const std::vector<MeshData>& meshes);
+
+	private:
+		MappedFile file;
+		std::vector<CachedMesh> meshes;
+	};
+
+}
+
+#endif
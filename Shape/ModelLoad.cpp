@@ -13,72 +13,90 @@
 #include <string>
 #include <vector>
 #include <map> 
+#include <chrono>
+#include <omp.h>
+#include "Core\Stats.h"
 
 namespace PBR {
 
     // (processMesh, processNode, loadModel, getDiffuseMaterial ֲ)
     // ...
-    std::shared_ptr<TriangleMesh> ModelLoad::processMesh(aiMesh* mesh, const aiScene* scene, const Transform& ObjectToWorld) {
-        // (˺ԭ)
+    std::shared_ptr<TriangleMesh> ModelLoad::processMesh(aiMesh* mesh, const aiScene* scene, const Transform& ObjectToWorld,
+        MeshData& data) {
+        // ȷŽMeshDataTriangleMeshҲд档
+        // ֻдdata뷵ֵڶ߳ͬʱͬ
         long nVertices = mesh->mNumVertices;
         long nTriangles = mesh->mNumFaces;
-        int* vertexIndices = new int[nTriangles * 3];
-        Point3f* P = new Point3f[nVertices];
-        Vector3f* S = nullptr;
-        Normal3f* N = new Normal3f[nVertices];
-        Point2f* uv = new Point2f[nVertices];
-        int* faceIndices = nullptr;
+        data.name = mesh->mName.C_Str();
+        data.P.resize(nVertices);
+        if (mesh->HasNormals()) data.N.resize(nVertices);
+        if (mesh->mTextureCoords[0]) data.uv.resize(nVertices);
+        data.indices.resize(nTriangles * 3);
         for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-            P[i].x = mesh->mVertices[i].x;
-            P[i].y = mesh->mVertices[i].y;
-            P[i].z = mesh->mVertices[i].z;
+            data.P[i].x = mesh->mVertices[i].x;
+            data.P[i].y = mesh->mVertices[i].y;
+            data.P[i].z = mesh->mVertices[i].z;
             if (mesh->HasNormals()) {
-                N[i].x = mesh->mNormals[i].x;
-                N[i].y = mesh->mNormals[i].y;
-                N[i].z = mesh->mNormals[i].z;
+                data.N[i].x = mesh->mNormals[i].x;
+                data.N[i].y = mesh->mNormals[i].y;
+                data.N[i].z = mesh->mNormals[i].z;
             }
             if (mesh->mTextureCoords[0]) {
-                uv[i].x = mesh->mTextureCoords[0][i].x;
-                uv[i].y = mesh->mTextureCoords[0][i].y;
+                data.uv[i].x = mesh->mTextureCoords[0][i].x;
+                data.uv[i].y = mesh->mTextureCoords[0][i].y;
             }
         }
         for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
             aiFace face = mesh->mFaces[i];
             for (unsigned int j = 0; j < face.mNumIndices; j++)
-                vertexIndices[3 * i + j] = face.mIndices[j];
-        }
-        if (!mesh->HasNormals()) {
-            delete[] N;
-            N = nullptr;
-        }
-        if (!mesh->mTextureCoords[0]) {
-            delete[] uv;
-            uv = nullptr;
+                data.indices[3 * i + j] = face.mIndices[j];
         }
-        std::shared_ptr<TriangleMesh> trimesh =
-            std::make_shared<TriangleMesh>(ObjectToWorld, nTriangles, vertexIndices, nVertices, P, S, N, uv, faceIndices);
-        std::string meshName = mesh->mName.C_Str();
-        meshNames.push_back(meshName);
-        diffTexName.push_back("");
-        specTexName.push_back("");
-        delete[] vertexIndices;
-        delete[] P;
-        delete[] S;
-        delete[] N;
-        delete[] uv;
+        std::shared_ptr<TriangleMesh> trimesh = std::make_shared<TriangleMesh>(
+            ObjectToWorld, nTriangles, data.indices.data(), nVertices, data.P.data(), nullptr,
+            data.N.empty() ? nullptr : data.N.data(), data.uv.empty() ? nullptr : data.uv.data(), nullptr);
         return trimesh;
     }
-    void ModelLoad::processNode(aiNode* node, const aiScene* scene, const Transform& ObjectToWorld) {
-        // (˺ԭ)
-        for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene, ObjectToWorld));
-        }
+    void ModelLoad::processNode(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& nodeMeshes) {
+        // ˳ռ֮ת˳봮һ
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+            nodeMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
         for (unsigned int i = 0; i < node->mNumChildren; i++)
-            processNode(node->mChildren[i], scene, ObjectToWorld);
+            processNode(node->mChildren[i], scene, nodeMeshes);
     }
     void ModelLoad::loadModel(std::string path, const Transform& ObjectToWorld) {
-        // (˺ԭ)
+        directory = path.substr(0, path.find_last_of('/'));
+        std::cout << "INFO: Texture directory set to: " << directory << std::endl;
+
+        // ЧʱֱӴӳĻ湹񣬲پAssimp
+        std::string cacheName = path + ".meshcache";
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        MeshCache cache;
+        if (cache.Open(cacheName, path)) {
+            int nMeshes = cache.MeshCount();
+            size_t first = meshes.size();
+            meshes.resize(first + nMeshes);
+            // 任أй
+#pragma omp parallel
+            {
+#pragma omp for schedule(dynamic)
+                for (int i = 0; i < nMeshes; i++) {
+                    const CachedMesh& mesh = cache.Mesh(i);
+                    meshes[first + i] = std::make_shared<TriangleMesh>(ObjectToWorld, mesh.nTriangles,
+                        mesh.indices, mesh.nVertices, mesh.P, nullptr, mesh.N, mesh.uv, nullptr);
+                }
+                MergeThreadStats();
+            }
+            for (int i = 0; i < nMeshes; i++) {
+                meshNames.push_back(cache.Mesh(i).name);
+                diffTexName.push_back("");
+                specTexName.push_back("");
+            }
+            std::cout << "INFO: Loaded " << cache.MeshCount() << " meshes from cache " << cacheName
+                << " in " << std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+            return;
+        }
+
         Assimp::Importer import;
         const aiScene* scene = import.ReadFile(path, aiProcess_Triangulate);
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
@@ -87,9 +105,30 @@ namespace PBR {
             std::cerr << "Assimp error: " << import.GetErrorString() << std::endl;
             return;
         }
-        directory = path.substr(0, path.find_last_of('/'));
-        std::cout << "INFO: Texture directory set to: " << directory << std::endl;
-        processNode(scene->mRootNode, scene, ObjectToWorld);
+        std::vector<aiMesh*> nodeMeshes;
+        processNode(scene->mRootNode, scene, nodeMeshes);
+        int nMeshes = (int)nodeMeshes.size();
+        size_t first = meshes.size();
+        meshes.resize(first + nMeshes);
+        importedMeshes.resize(nMeshes);
+#pragma omp parallel
+        {
+#pragma omp for schedule(dynamic)
+            for (int i = 0; i < nMeshes; i++)
+                meshes[first + i] = processMesh(nodeMeshes[i], scene, ObjectToWorld, importedMeshes[i]);
+            MergeThreadStats();
+        }
+        for (int i = 0; i < nMeshes; i++) {
+            meshNames.push_back(importedMeshes[i].name);
+            diffTexName.push_back("");
+            specTexName.push_back("");
+        }
+        std::cout << "INFO: Imported " << importedMeshes.size() << " meshes in "
+            << std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+        if (!MeshCache::Write(cacheName, path, importedMeshes))
+            std::cerr << "WARNING: Can't write mesh cache " << cacheName << std::endl;
+        importedMeshes.clear();
     }
     inline std::shared_ptr<Material> getDiffuseMaterial(std::string filename) {
         // (˺ԭ)
@@ -111,76 +150,78 @@ namespace PBR {
     // 1. 滻 getPlasticMaterial
     // ==========================================================
 
+    // һPBRʵͼ (Diffuse, Metalness, Roughness)ļΪձʾʹĬϳ
+    struct PbrTextureFiles {
+        std::string diffFilename, metalFilename, roughFilename;
+    };
+
     /**
-     * @brief Ϊ PBR  (Diffuse, Metalness, Roughness) һ PlasticMaterial
-     * Ⱦʵ PBR ģֶʽ
+     * @brief Ϊ PBR һ PlasticMaterial
+     * ͼÿ3ţΪн룬ʱͬ
+     * ûͼʱ Kd Ĭ0.5ɫKr Ĭ0ǽֲڶĬϳ0.8
      */
-    inline std::shared_ptr<Material> createManualPbrMaterial(
-        const std::string& diffFilename,
-        const std::string& metalFilename,
-        const std::string& roughFilename)
+    static std::vector<std::shared_ptr<Material>> createManualPbrMaterials(
+        const std::vector<PbrTextureFiles>& files)
     {
-        // --- 1.  Diffuse (Kd) ---
-        std::shared_ptr<Texture<Spectrum>> plasticKd;
-        if (diffFilename.empty()) {
-            plasticKd = std::make_shared<ConstantTexture<Spectrum>>(Spectrum(0.5f)); // Ĭϻɫ
-        }
-        else {
-            std::cout << "DEBUG: [createManualPbrMaterial] Loading Kd: " << diffFilename << std::endl;
-            std::unique_ptr<TextureMapping2D> map1 = std::make_unique<UVMapping2D>(1.f, 1.f, 0.f, 0.f);
-            plasticKd = std::make_shared<ImageTexture<RGBSpectrum, Spectrum>>(std::move(map1), diffFilename, false, 8.f, ImageWrap::Repeat, 1.f, false);
-        }
-
-        // --- 2.  Metalness ( Ks) ---
-        std::shared_ptr<Texture<Spectrum>> plasticKr;
-        if (metalFilename.empty()) {
-            plasticKr = std::make_shared<ConstantTexture<Spectrum>>(Spectrum(0.0f)); // ĬϷǽ (ɫ)
-        }
-        else {
-            std::cout << "DEBUG: [createManualPbrMaterial] Loading Kr (from Metal): " << metalFilename << std::endl;
-            std::unique_ptr<TextureMapping2D> map2 = std::make_unique<UVMapping2D>(1.f, 1.f, 0.f, 0.f);
-            // ȻȼΪ SpectrumΪ Ks Ҫ
-            plasticKr = std::make_shared<ImageTexture<RGBSpectrum, Spectrum>>(std::move(map2), metalFilename, false, 8.f, ImageWrap::Repeat, 1.f, false);
+        int nMaterials = (int)files.size();
+        std::vector<std::shared_ptr<Texture<Spectrum>>> plasticKd(nMaterials), plasticKr(nMaterials);
+        std::vector<std::shared_ptr<Texture<float>>> plasticRoughness(nMaterials);
+        for (int i = 0; i < nMaterials; i++) {
+            if (!files[i].diffFilename.empty())
+                std::cout << "DEBUG: [createManualPbrMaterials] Loading Kd: " << files[i].diffFilename << std::endl;
+            if (!files[i].metalFilename.empty())
+                std::cout << "DEBUG: [createManualPbrMaterials] Loading Kr (from Metal): " << files[i].metalFilename << std::endl;
+            if (!files[i].roughFilename.empty())
+                std::cout << "DEBUG: [createManualPbrMaterials] Loading Roughness: " << files[i].roughFilename << std::endl;
         }
 
-        // --- 3.  Roughness (ֲڶ) ---
-        std::shared_ptr<Texture<float>> plasticRoughness;
-        if (roughFilename.empty()) {
-            // ûдֲڶͼŻ˵Ӳֵ
-            std::cout << "DEBUG: [createManualPbrMaterial] No roughness map. Using Constant 0.8." << std::endl;
-            plasticRoughness = std::make_shared<ConstantTexture<float>>(0.8f);
-        }
-        else {
-            // 򣬼شֲڶͼ
-            // Ҫ:  ImageTexture<float, float> Թ ( MIPMap ֧ float)
-            std::cout << "DEBUG: [createManualPbrMaterial] Loading Roughness: " << roughFilename << std::endl;
-            std::unique_ptr<TextureMapping2D> map3 = std::make_unique<UVMapping2D>(1.f, 1.f, 0.f, 0.f);
-            plasticRoughness = std::make_shared<ImageTexture<float, float>>(std::move(map3), roughFilename, false, 8.f, ImageWrap::Repeat, 1.f, false);
+        // tӦt/3ĵt%3ͼImageTexture::GetTexture룬
+        // ͬļֻᱻһ
+#pragma omp parallel for schedule(dynamic)
+        for (int t = 0; t < 3 * nMaterials; t++) {
+            const PbrTextureFiles& f = files[t / 3];
+            std::unique_ptr<TextureMapping2D> map(new UVMapping2D(1.f, 1.f, 0.f, 0.f));
+            switch (t % 3) {
+            case 0: // --- 1.  Diffuse (Kd) ---
+                if (f.diffFilename.empty())
+                    plasticKd[t / 3] = std::make_shared<ConstantTexture<Spectrum>>(Spectrum(0.5f)); // Ĭϻɫ
+                else
+                    plasticKd[t / 3] = std::make_shared<ImageTexture<RGBSpectrum, Spectrum>>(std::move(map), f.diffFilename, false, 8.f, ImageWrap::Repeat, 1.f, false);
+                break;
+            case 1: // --- 2.  Metalness ( Ks) ---
+                if (f.metalFilename.empty())
+                    plasticKr[t / 3] = std::make_shared<ConstantTexture<Spectrum>>(Spectrum(0.0f)); // ĬϷǽ (ɫ)
+                else
+                    plasticKr[t / 3] = std::make_shared<ImageTexture<RGBSpectrum, Spectrum>>(std::move(map), f.metalFilename, false, 8.f, ImageWrap::Repeat, 1.f, false);
+                break;
+            default: // --- 3.  Roughness (ֲڶ) ---
+                // Ҫ:  ImageTexture<float, float> Թ ( MIPMap ֧ float)
+                if (f.roughFilename.empty())
+                    plasticRoughness[t / 3] = std::make_shared<ConstantTexture<float>>(0.8f);
+                else
+                    plasticRoughness[t / 3] = std::make_shared<ImageTexture<float, float>>(std::move(map), f.roughFilename, false, 8.f, ImageWrap::Repeat, 1.f, false);
+                break;
+            }
         }
 
         // --- 4.  ---
+        std::vector<std::shared_ptr<Material>> materials(nMaterials);
         std::shared_ptr<Texture<float>> bumpMap = std::make_shared<ConstantTexture<float>>(0.0f);
-        // remapRoughness :  MetalMaterial Ϊ falseҲΪ false
-        return std::make_shared<PlasticMaterial>(plasticKd, plasticKr, plasticRoughness, bumpMap, false);
+        for (int i = 0; i < nMaterials; i++)
+            // remapRoughness :  MetalMaterial Ϊ falseҲΪ false
+            materials[i] = std::make_shared<PlasticMaterial>(plasticKd[i], plasticKr[i], plasticRoughness[i], bumpMap, false);
+        return materials;
     }
 
-    // (ɵ getPlasticMaterial ڿɾˣΪ createManualPbrMaterial )
+    // (ɵ getPlasticMaterial ڿɾˣΪ createManualPbrMaterials )
 
 
     // ... (buildNoTextureModel ֲ) ...
-    void ModelLoad::buildNoTextureModel(Transform& tri_Object2World, const MediumInterface& mediumInterface,
+    void ModelLoad::buildNoTextureModel(const Transform& tri_Object2World, const MediumInterface& mediumInterface,
         std::vector<std::shared_ptr<Primitive>>& prims, std::shared_ptr<Material> material) {
-        // (˺ԭ)
-        std::vector<std::shared_ptr<Shape>> trisObj;
-        Transform tri_World2Object = Inverse(tri_Object2World);
-        for (int i = 0; i < meshes.size(); i++) {
-            for (int j = 0; j < meshes[i]->nTriangles; ++j) {
-                std::shared_ptr<TriangleMesh> meshPtr = meshes[i];
-                trisObj.push_back(std::make_shared<Triangle>(&tri_Object2World, &tri_World2Object, false, meshPtr, j));
-            }
-        }
-        for (int i = 0; i < trisObj.size(); ++i)
-            prims.push_back(std::make_shared<GeometricPrimitive>(trisObj[i], material, nullptr, mediumInterface));
+        // ÿһͼԪBVHֱе
+        for (int i = 0; i < meshes.size(); i++)
+            prims.push_back(std::make_shared<TriangleMeshPrimitive>(meshes[i], tri_Object2World, material, mediumInterface));
         meshes.clear();
         diffTexName.clear();
         specTexName.clear();
@@ -191,64 +232,56 @@ namespace PBR {
     // ==========================================================
     // 2.  buildTextureModel
     // ==========================================================
-    void ModelLoad::buildTextureModel(Transform& tri_Object2World, const MediumInterface& mediumInterface,
+    void ModelLoad::buildTextureModel(const Transform& tri_Object2World, const MediumInterface& mediumInterface,
         std::vector<std::shared_ptr<Primitive>>& prims) {
 
         // --- 1. ֶ ---
         std::cout << "--- Pre-loading materials ---" << std::endl;
+        auto start = std::chrono::steady_clock::now();
         preloadedMaterials.clear();
 
-        // ڻǵº _R.png ͼ
-        preloadedMaterials["cloth"] = createManualPbrMaterial(
-            directory + "/T_cloth_D.png", //  (Kd)
-            directory + "/T_cloth_M.png", //  (Ks)
-            directory + "/T_cloth_R.png"  // ֲڶ (Roughness)
-        );
+        // ͼһδƥĬϲ
+        const char* materialNames[] = { "cloth", "metal", "sword", "default" };
+        std::vector<PbrTextureFiles> files = {
+            { directory + "/T_cloth_D.png",   //  (Kd)
+              directory + "/T_cloth_M.png",   //  (Ks)
+              directory + "/T_cloth_R.png" }, // ֲڶ (Roughness)
+            { directory + "/T_metal_D.png", directory + "/T_metal_M.png", directory + "/T_metal_R.png" },
+            // ע⡿: ļ "T_swordl_D.png"Ҳ "T_sword_D.png" ( 'l' ޸)
+            { directory + "/T_sword_D.png", directory + "/T_sword_M.png", directory + "/T_sword_R.png" },
+            { "", "", "" }
+        };
+        std::vector<std::shared_ptr<Material>> materials = createManualPbrMaterials(files);
+        for (size_t i = 0; i < materials.size(); i++)
+            preloadedMaterials[materialNames[i]] = materials[i];
+        std::cout << "--- Material pre-loading complete ("
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+            << " ms) ---" << std::endl;
 
-        // getMetalMaterial
-        preloadedMaterials["metal"] = createManualPbrMaterial(
-            directory + "/T_metal_D.png",
-            directory + "/T_metal_M.png",
-            directory + "/T_metal_R.png"
-        );
-
-        // ע⡿: ļ "T_swordl_D.png"Ҳ "T_sword_D.png"
-        preloadedMaterials["sword"] = createManualPbrMaterial(
-            directory + "/T_sword_D.png", // ( 'l' ޸)
-            directory + "/T_sword_M.png", // ( T_sword_M.png )
-            directory + "/T_sword_R.png"
-        );
-
-        // Ĭϲʣδƥ
-        preloadedMaterials["default"] = createManualPbrMaterial("", "", "");
-        std::cout << "--- Material pre-loading complete ---" << std::endl;
-
-
-        std::vector<std::shared_ptr<Shape>> trisObj;
-        Transform tri_World2Object = Inverse(tri_Object2World);
 
         // --- 2. ѭ񲢷 ---
+        // ƥʲͼԪ񻥲أдԭ˳prims
         std::cout << "--- Assigning materials to meshes ---" << std::endl;
-        for (int i = 0; i < meshes.size(); i++) {
+        int nMeshes = (int)meshes.size();
+        std::vector<std::shared_ptr<Primitive>> meshPrims(nMeshes);
+        std::vector<int> materialIndex(nMeshes);
+#pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < nMeshes; i++) {
 
-            std::string meshName = meshNames[i];
-            std::cout << "Processing Mesh (" << i << "/" << meshes.size() << "): " << meshName << std::endl;
+            const std::string& meshName = meshNames[i];
 
             // --- ֶ ---
-            std::shared_ptr<Material> finalMaterial = preloadedMaterials["default"];
-            std::string materialName = "default";
+            int m = 3; // default
 
             if (meshName.rfind("Hood", 0) == 0 ||
                 meshName.rfind("Padded", 0) == 0 ||
                 meshName.rfind("Dress", 0) == 0)
             {
-                finalMaterial = preloadedMaterials["cloth"];
-                materialName = "cloth";
+                m = 0; // cloth
             }
             else if (meshName.rfind("Merged_Sword", 0) == 0)
             {
-                finalMaterial = preloadedMaterials["sword"];
-                materialName = "sword";
+                m = 2; // sword
             }
             else if (meshName.rfind("Crown", 0) == 0 ||
                 meshName.rfind("Head_Mask", 0) == 0 ||
@@ -260,33 +293,26 @@ namespace PBR {
                 meshName.rfind("Belt", 0) == 0 ||
                 meshName.rfind("Boot", 0) == 0)
             {
-                finalMaterial = preloadedMaterials["metal"];
-                materialName = "metal";
+                m = 1; // metal
             }
-
-            std::cout << "  -> Match: '" << materialName << "'. Assigning material." << std::endl;
+            materialIndex[i] = m;
 
 
             // --- 3. ͼԪ ---
-            // (˲ֱֲ䣬ڻʹȷ finalMaterial)
-            if (mediumInterface.inside == nullptr && mediumInterface.outside == nullptr) {
-                for (int j = 0; j < meshes[i]->nTriangles; ++j) {
-                    std::shared_ptr<TriangleMesh> meshPtr = meshes[i];
-                    prims.push_back(std::make_shared<GeometricPrimitive>(
-                        std::make_shared<Triangle>(&tri_Object2World, &tri_World2Object, false, meshPtr, j),
-                        finalMaterial,
-                        nullptr, mediumInterface));
-                }
-            }
-            else {
-                for (int j = 0; j < meshes[i]->nTriangles; ++j) {
-                    std::shared_ptr<TriangleMesh> meshPtr = meshes[i];
-                    prims.push_back(std::make_shared<GeometricPrimitive>(
-                        std::make_shared<Triangle>(&tri_Object2World, &tri_World2Object, false, meshPtr, j),
-                        nullptr, nullptr, mediumInterface));
-                }
-            }
+            // ÿһ TriangleMeshPrimitiveʰ洢
+            // (ʱ߽񲻴ʣ֮ǰδʱһ)
+            std::shared_ptr<Material> meshMaterial =
+                (mediumInterface.inside == nullptr && mediumInterface.outside == nullptr) ? materials[m] : nullptr;
+            meshPrims[i] = std::make_shared<TriangleMeshPrimitive>(
+                meshes[i], tri_Object2World, meshMaterial, mediumInterface);
         }
+        prims.insert(prims.end(), meshPrims.begin(), meshPrims.end());
+
+        int materialCount[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < nMeshes; i++) materialCount[materialIndex[i]]++;
+        std::cout << "INFO: Assigned " << nMeshes << " meshes:";
+        for (int m = 0; m < 4; m++) std::cout << " " << materialNames[m] << "=" << materialCount[m];
+        std::cout << std::endl;
 
         // --- 4.  ---
         meshes.clear();
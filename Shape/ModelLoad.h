@@ -7,6 +7,7 @@
 
 #include "Core\PBR.h"
 #include "Shape\Triangle.h"
+#include "Shape\MeshCache.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -33,15 +34,18 @@ namespace PBR {
 		std::vector<std::string> meshNames; // ڴ洢
 		// (ǻʹһ map ԤزʣЧ)
 		std::map<std::string, std::shared_ptr<Material>> preloadedMaterials;
+		// δAssimploadModelʱд뻺
+		std::vector<MeshData> importedMeshes;
 
 		std::string directory;
 		//    
 		void loadModel(std::string path, const Transform& ObjectToWorld);
-		void processNode(aiNode* node, const aiScene* scene, const Transform& ObjectToWorld);
-		std::shared_ptr<TriangleMesh> processMesh(aiMesh* mesh, const aiScene* scene, const Transform& ObjectToWorld);
-		void buildNoTextureModel(Transform& tri_Object2World, const MediumInterface& mediumInterface,
+		void processNode(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& nodeMeshes);
+		std::shared_ptr<TriangleMesh> processMesh(aiMesh* mesh, const aiScene* scene, const Transform& ObjectToWorld,
+			MeshData& data);
+		void buildNoTextureModel(const Transform& tri_Object2World, const MediumInterface& mediumInterface,
 			std::vector<std::shared_ptr<Primitive>>& prims, std::shared_ptr<Material> material);
-		void ModelLoad::buildTextureModel(Transform& tri_Object2World, const MediumInterface& mediumInterface,
+		void buildTextureModel(const Transform& tri_Object2World, const MediumInterface& mediumInterface,
 			std::vector<std::shared_ptr<Primitive>>& prims);
 	};
 }
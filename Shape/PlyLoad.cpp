@@ -0,0 +1,482 @@
+#include "Shape\PlyLoad.h"
+#include "Core\MappedFile.h"
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace PBR {
+
+	enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+	struct PlyProperty {
+		std::string name;
+		// ԵͣбʱΪб
+		PlyType type;
+		bool isList;
+		PlyType countType;
+	};
+
+	struct PlyElement {
+		std::string name;
+		long long count;
+		std::vector<PlyProperty> props;
+	};
+
+	static PlyType plyType(const std::string& s) {
+		if (s == "char" || s == "int8") return PlyType::Int8;
+		if (s == "uchar" || s == "uint8") return PlyType::UInt8;
+		if (s == "short" || s == "int16") return PlyType::Int16;
+		if (s == "ushort" || s == "uint16") return PlyType::UInt16;
+		if (s == "int" || s == "int32") return PlyType::Int32;
+		if (s == "uint" || s == "uint32") return PlyType::UInt32;
+		if (s == "float" || s == "float32") return PlyType::Float32;
+		if (s == "double" || s == "float64") return PlyType::Float64;
+		return PlyType::Invalid;
+	}
+
+	static int plyTypeSize(PlyType t) {
+		switch (t) {
+		case PlyType::Int8: case PlyType::UInt8: return 1;
+		case PlyType::Int16: case PlyType::UInt16: return 2;
+		case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+		case PlyType::Float64: return 8;
+		default: return 0;
+		}
+	}
+
+	// ȡһƱswapΪtrueʱȷתֽ
+	static inline double readBinary(const char* p, PlyType t, bool swap) {
+		unsigned char b[8];
+		int n = plyTypeSize(t);
+		if (swap)
+			for (int i = 0; i < n; ++i) b[i] = (unsigned char)p[n - 1 - i];
+		else
+			memcpy(b, p, n);
+		switch (t) {
+		case PlyType::Int8: return (int8_t)b[0];
+		case PlyType::UInt8: return b[0];
+		case PlyType::Int16: { int16_t v; memcpy(&v, b, 2); return v; }
+		case PlyType::UInt16: { uint16_t v; memcpy(&v, b, 2); return v; }
+		case PlyType::Int32: { int32_t v; memcpy(&v, b, 4); return v; }
+		case PlyType::UInt32: { uint32_t v; memcpy(&v, b, 4); return v; }
+		case PlyType::Float32: { float v; memcpy(&v, b, 4); return v; }
+		case PlyType::Float64: { double v; memcpy(&v, b, 8); return v; }
+		default: return 0;
+		}
+	}
+
+	// ٽһʮ򸡵ǰհףpƶ֮
+	// Чȡ19λ15λβС2^53ָ[-22, 22]ʱֻһ룬strtodһ£
+	// мulpתΪfloatûӰ
+	static inline bool parseNumber(const char*& p, const char* end, double* value) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+		if (p == end) return false;
+		bool negative = false;
+		if (*p == '-' || *p == '+') negative = (*p++ == '-');
+		uint64_t mantissa = 0;
+		int exponent = 0, nDigits = 0;
+		const char* start = p;
+		for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+			if (nDigits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) ++nDigits;
+			}
+			else
+				++exponent;
+		}
+		if (p < end && *p == '.') {
+			++p;
+			for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+				if (nDigits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa) ++nDigits;
+					--exponent;
+				}
+			}
+		}
+		if (p == start) return false;
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			++p;
+			bool negExp = false;
+			if (p < end && (*p == '-' || *p == '+')) negExp = (*p++ == '-');
+			int e = 0;
+			for (; p < end && *p >= '0' && *p <= '9'; ++p) e = std::min(e * 10 + (*p - '0'), 100000);
+			exponent += negExp ? -e : e;
+		}
+		static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		double v = (double)mantissa;
+		if (exponent >= 0 && exponent <= 22) v *= pow10[exponent];
+		else if (exponent < 0 && exponent >= -22) v /= pow10[-exponent];
+		else v *= std::pow(10.0, exponent);
+		*value = negative ? -v : v;
+		return true;
+	}
+
+	// ΰǻ
+	static inline void addPolygon(const int* v, int n, std::vector<int>& indices) {
+		for (int i = 1; i + 1 < n; ++i) {
+			indices.push_back(v[0]);
+			indices.push_back(v[i]);
+			indices.push_back(v[i + 1]);
+		}
+	}
+
+	// vertexԪиӦţ-1ʾû
+	struct PlyVertexLayout {
+		int p[3], n[3], uv[2];
+		//  -> λ0-2λã3-5ߣ6-7 UVҪΪ-1
+		std::vector<int> slot;
+	};
+
+	static PlyVertexLayout vertexLayout(const PlyElement& e) {
+		PlyVertexLayout l;
+		for (int i = 0; i < 3; ++i) l.p[i] = l.n[i] = -1;
+		l.uv[0] = l.uv[1] = -1;
+		for (int i = 0; i < (int)e.props.size(); ++i) {
+			const std::string& s = e.props[i].name;
+			if (e.props[i].isList) continue;
+			if (s == "x") l.p[0] = i;
+			else if (s == "y") l.p[1] = i;
+			else if (s == "z") l.p[2] = i;
+			else if (s == "nx") l.n[0] = i;
+			else if (s == "ny") l.n[1] = i;
+			else if (s == "nz") l.n[2] = i;
+			else if (s == "u" || s == "s" || s == "texture_u") l.uv[0] = i;
+			else if (s == "v" || s == "t" || s == "texture_v") l.uv[1] = i;
+		}
+		l.slot.assign(e.props.size(), -1);
+		for (int i = 0; i < 3; ++i) {
+			if (l.p[i] >= 0) l.slot[l.p[i]] = i;
+			if (l.n[i] >= 0) l.slot[l.n[i]] = 3 + i;
+		}
+		for (int i = 0; i < 2; ++i)
+			if (l.uv[i] >= 0) l.slot[l.uv[i]] = 6 + i;
+		return l;
+	}
+
+	static int faceIndexProperty(const PlyElement& e) {
+		for (int i = 0; i < (int)e.props.size(); ++i)
+			if (e.props[i].isList &&
+				(e.props[i].name == "vertex_indices" || e.props[i].name == "vertex_index"))
+				return i;
+		return -1;
+	}
+
+	// һλֵдmesh
+	static inline void storeVertex(MeshData* mesh, long long i, const double* v) {
+		mesh->P[i] = Point3f((float)v[0], (float)v[1], (float)v[2]);
+		if (!mesh->N.empty()) mesh->N[i] = Normal3f((float)v[3], (float)v[4], (float)v[5]);
+		if (!mesh->uv.empty()) mesh->uv[i] = Point2f((float)v[6], (float)v[7]);
+	}
+
+	// asciiһж㣬λֵдvaluesֲʽʱfalse
+	static bool parseVertexLine(const char* q, const char* lineEnd, const PlyElement& e,
+		const PlyVertexLayout& l, double values[8]) {
+		for (int k = 0; k < (int)e.props.size(); ++k) {
+			double v;
+			if (!parseNumber(q, lineEnd, &v)) return false;
+			// бֻ
+			if (e.props[k].isList) {
+				if (v < 0 || v > lineEnd - q) return false;
+				for (int j = 0; j < (int)v; ++j)
+					if (!parseNumber(q, lineEnd, &v)) return false;
+			}
+			else if (l.slot[k] >= 0)
+				values[l.slot[k]] = v;
+		}
+		return true;
+	}
+
+	// asciiһ棬ǻ׷ӵoutʱ׷κfalse
+	static bool parseFaceLine(const char* q, const char* lineEnd, const PlyElement& e, int indexProp,
+		std::vector<int>& poly, std::vector<int>& out) {
+		int polySize = -1;
+		for (int k = 0; k < (int)e.props.size(); ++k) {
+			double v;
+			if (!parseNumber(q, lineEnd, &v)) return false;
+			if (!e.props[k].isList) continue;
+			// ÿбռ2ַбȲܳеʣ೤
+			if (v < 0 || v > lineEnd - q) return false;
+			int n = (int)v;
+			if (k == indexProp) {
+				poly.resize(n);
+				polySize = n;
+			}
+			for (int j = 0; j < n; ++j) {
+				if (!parseNumber(q, lineEnd, &v)) return false;
+				if (k == indexProp) poly[j] = (int)v;
+			}
+		}
+		if (polySize > 0) addPolygon(poly.data(), polySize, out);
+		return true;
+	}
+
+	// asciiÿԪռһС˳ҳףٰвн
+	static bool parseAscii(const char* p, const char* end, const std::vector<PlyElement>& elements,
+		MeshData* mesh) {
+		for (const PlyElement& e : elements) {
+			std::vector<const char*> lines((size_t)e.count + 1);
+			for (long long i = 0; i < e.count; ++i) {
+				// 
+				while (p < end && (*p == '\n' || *p == '\r')) ++p;
+				if (p == end) return false;
+				lines[i] = p;
+				const char* nl = (const char*)memchr(p, '\n', end - p);
+				p = nl ? nl + 1 : end;
+			}
+			lines[e.count] = p;
+
+			if (e.name == "vertex") {
+				PlyVertexLayout l = vertexLayout(e);
+				// ̷ֱ߳¼ǷѭԼ
+				bool ok = true;
+#pragma omp parallel for schedule(static) reduction(&&:ok)
+				for (long long i = 0; i < e.count; ++i) {
+					double values[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+					if (parseVertexLine(lines[i], lines[i + 1], e, l, values))
+						storeVertex(mesh, i, values);
+					else
+						ok = false;
+				}
+				if (!ok) return false;
+			}
+			else if (e.name == "face") {
+				int indexProp = faceIndexProperty(e);
+				if (indexProp < 0) return false;
+				// ÿ߳̽һУ˳ƴӣ봮һ
+				int nChunks = std::max(1, std::min(omp_get_max_threads() * 4, (int)(e.count / 4096) + 1));
+				std::vector<std::vector<int>> chunks(nChunks);
+				bool ok = true;
+#pragma omp parallel for schedule(dynamic) reduction(&&:ok)
+				for (int c = 0; c < nChunks; ++c) {
+					long long begin = e.count * c / nChunks, endLine = e.count * (c + 1) / nChunks;
+					std::vector<int>& out = chunks[c];
+					out.reserve((size_t)(endLine - begin) * 3);
+					std::vector<int> poly;
+					// ʱһβٽļ
+					for (long long i = begin; i < endLine; ++i)
+						if (!parseFaceLine(lines[i], lines[i + 1], e, indexProp, poly, out)) {
+							ok = false;
+							break;
+						}
+				}
+				if (!ok) return false;
+				size_t total = 0;
+				for (const std::vector<int>& c : chunks) total += c.size();
+				mesh->indices.reserve(total);
+				for (const std::vector<int>& c : chunks)
+					mesh->indices.insert(mesh->indices.end(), c.begin(), c.end());
+			}
+		}
+		return true;
+	}
+
+	// ƣԪֱӰʣ㲢жȡбԵԪ˳
+	static bool parseBinary(const char* p, const char* end, const std::vector<PlyElement>& elements,
+		bool swap, MeshData* mesh) {
+		for (const PlyElement& e : elements) {
+			int nProps = (int)e.props.size();
+			bool fixedSize = true;
+			std::vector<int> offsets(nProps);
+			int stride = 0;
+			for (int k = 0; k < nProps; ++k) {
+				if (e.props[k].isList) fixedSize = false;
+				offsets[k] = stride;
+				stride += plyTypeSize(e.props[k].type);
+			}
+
+			if (fixedSize) {
+				if ((size_t)(end - p) < (size_t)stride * (size_t)e.count) return false;
+				if (e.name == "vertex") {
+					PlyVertexLayout l = vertexLayout(e);
+					const char* base = p;
+#pragma omp parallel for schedule(static)
+					for (long long i = 0; i < e.count; ++i) {
+						const char* v = base + (size_t)i * stride;
+						double values[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+						for (int k = 0; k < nProps; ++k)
+							if (l.slot[k] >= 0)
+								values[l.slot[k]] = readBinary(v + offsets[k], e.props[k].type, swap);
+						storeVertex(mesh, i, values);
+					}
+				}
+				p += (size_t)stride * (size_t)e.count;
+				continue;
+			}
+
+			// бԣԪ˳ȡıͬλд룬бֻ
+			bool isVertex = e.name == "vertex";
+			PlyVertexLayout l;
+			if (isVertex) l = vertexLayout(e);
+			int indexProp = e.name == "face" ? faceIndexProperty(e) : -1;
+			if (e.name == "face" && indexProp < 0) return false;
+			std::vector<int> poly;
+			if (indexProp >= 0) mesh->indices.reserve((size_t)e.count * 3);
+			for (long long i = 0; i < e.count; ++i) {
+				double values[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+				for (int k = 0; k < nProps; ++k) {
+					const PlyProperty& prop = e.props[k];
+					if (!prop.isList) {
+						int size = plyTypeSize(prop.type);
+						if (end - p < size) return false;
+						if (isVertex && l.slot[k] >= 0)
+							values[l.slot[k]] = readBinary(p, prop.type, swap);
+						p += size;
+						continue;
+					}
+					int countSize = plyTypeSize(prop.countType), itemSize = plyTypeSize(prop.type);
+					if (end - p < countSize) return false;
+					int n = (int)readBinary(p, prop.countType, swap);
+					p += countSize;
+					if (n < 0 || end - p < (ptrdiff_t)n * itemSize) return false;
+					if (k == indexProp) {
+						poly.resize(n);
+						for (int j = 0; j < n; ++j)
+							poly[j] = (int)readBinary(p + j * itemSize, prop.type, swap);
+						addPolygon(poly.data(), n, mesh->indices);
+					}
+					p += (size_t)n * itemSize;
+				}
+				if (isVertex) storeVertex(mesh, i, values);
+			}
+		}
+		return true;
+	}
+
+	bool LoadPly(const std::string& filename, MeshData* mesh) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		MappedFile file;
+		if (!file.Open(filename)) {
+			std::cerr << "ERROR: Can't open PLY file: " << filename << std::endl;
+			return false;
+		}
+		const char* data = file.Data();
+		const char* end = data + file.Size();
+
+		// ļͷ
+		enum { Ascii, BinaryLittle, BinaryBig } format = Ascii;
+		std::vector<PlyElement> elements;
+		const char* p = data;
+		bool first = true, headerDone = false;
+		while (p < end && !headerDone) {
+			const char* nl = (const char*)memchr(p, '\n', end - p);
+			const char* lineEnd = nl ? nl : end;
+			std::istringstream line(std::string(p, lineEnd));
+			p = nl ? nl + 1 : end;
+			std::string keyword;
+			line >> keyword;
+			if (first) {
+				if (keyword != "ply") {
+					std::cerr << "ERROR: Not a PLY file: " << filename << std::endl;
+					return false;
+				}
+				first = false;
+			}
+			else if (keyword == "format") {
+				std::string f;
+				line >> f;
+				if (f == "ascii") format = Ascii;
+				else if (f == "binary_little_endian") format = BinaryLittle;
+				else if (f == "binary_big_endian") format = BinaryBig;
+				else {
+					std::cerr << "ERROR: Unknown PLY format \"" << f << "\": " << filename << std::endl;
+					return false;
+				}
+			}
+			else if (keyword == "element") {
+				PlyElement e;
+				if (!(line >> e.name >> e.count) || e.count < 0) {
+					std::cerr << "ERROR: Invalid PLY element count: " << filename << std::endl;
+					return false;
+				}
+				elements.push_back(e);
+			}
+			else if (keyword == "property") {
+				if (elements.empty()) return false;
+				PlyProperty prop;
+				std::string type;
+				line >> type;
+				prop.isList = type == "list";
+				prop.countType = PlyType::Invalid;
+				if (prop.isList) {
+					std::string countType;
+					line >> countType >> type;
+					prop.countType = plyType(countType);
+				}
+				prop.type = plyType(type);
+				line >> prop.name;
+				if (prop.type == PlyType::Invalid || (prop.isList && prop.countType == PlyType::Invalid)) {
+					std::cerr << "ERROR: Unknown PLY property type \"" << type << "\": " << filename << std::endl;
+					return false;
+				}
+				elements.back().props.push_back(prop);
+			}
+			else if (keyword == "end_header")
+				headerDone = true;
+		}
+		if (!headerDone) {
+			std::cerr << "ERROR: Incomplete PLY header: " << filename << std::endl;
+			return false;
+		}
+
+		// ÿԪļռõֽasciiÿһַһָΪбȣ
+		// Ԫļʣಿɵʱļͷ󣬲ܰڴ
+		for (const PlyElement& e : elements) {
+			size_t minBytes = 0;
+			for (const PlyProperty& prop : e.props)
+				minBytes += format == Ascii ? 2 : plyTypeSize(prop.isList ? prop.countType : prop.type);
+			// asciiУûԵԪÿҲһַ
+			if (format == Ascii) minBytes = std::max(minBytes, (size_t)1);
+			if (minBytes > 0 && (unsigned long long)e.count > (size_t)(end - p) / minBytes) {
+				std::cerr << "ERROR: PLY element count exceeds file size: " << filename << std::endl;
+				return false;
+			}
+		}
+
+		// 䶥飬ȱx/y/zʱ޷ʹ
+		const PlyElement* vertexElement = nullptr;
+		for (const PlyElement& e : elements)
+			if (e.name == "vertex") vertexElement = &e;
+		if (!vertexElement) return false;
+		PlyVertexLayout l = vertexLayout(*vertexElement);
+		if (l.p[0] < 0 || l.p[1] < 0 || l.p[2] < 0) {
+			std::cerr << "ERROR: PLY vertices have no x/y/z: " << filename << std::endl;
+			return false;
+		}
+		long long nVertices = vertexElement->count;
+		mesh->name = filename;
+		mesh->P.assign((size_t)nVertices, Point3f());
+		mesh->N.clear();
+		mesh->uv.clear();
+		mesh->indices.clear();
+		if (l.n[0] >= 0 && l.n[1] >= 0 && l.n[2] >= 0) mesh->N.assign((size_t)nVertices, Normal3f());
+		if (l.uv[0] >= 0 && l.uv[1] >= 0) mesh->uv.assign((size_t)nVertices, Point2f());
+
+		// жϱֽ
+		const uint16_t one = 1;
+		bool hostLittle = *(const unsigned char*)&one == 1;
+		bool ok = format == Ascii ? parseAscii(p, end, elements, mesh) :
+			parseBinary(p, end, elements, (format == BinaryLittle) != hostLittle, mesh);
+		if (!ok) {
+			std::cerr << "ERROR: Truncated or malformed PLY file: " << filename << std::endl;
+			return false;
+		}
+		for (size_t i = 0; i < mesh->indices.size(); ++i)
+			if (mesh->indices[i] < 0 || mesh->indices[i] >= nVertices) {
+				std::cerr << "ERROR: PLY vertex index out of range: " << filename << std::endl;
+				return false;
+			}
+
+		std::cout << "INFO: Loaded PLY " << filename << ": " << nVertices << " vertices, "
+			<< mesh->indices.size() / 3 << " triangles in "
+			<< std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+		return true;
+	}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+#ifndef __PlyLoad_h__
+#define __PlyLoad_h__
+
+#include "Core\PBR.h"
+#include "Shape\MeshCache.h"
+#include <string>
+
+namespace PBR {
+
+	// ȡPLYģͣasciibinary_little_endianbinary_big_endian
+	// vertexԪʶx/y/znx/ny/nzԼu/vs/ttexture_u/texture_v
+	// faceԪصvertex_indicesvertex_indexбǻԪ
+	// ļֱڴӳȡasciiļвн
+	// 㱣ռ䣬ŵȱ任TriangleMeshObjectToWorldʧʱfalse
+	bool LoadPly(const std::string& filename, MeshData* mesh);
+
+}
+
+#endif
@@ -1,16 +1,16 @@
 #include "Core\PBR.h"
 #include "Shape\Shape.h"
 #include "Core\interaction.h"
+#include "Core\Stats.h"
 
 namespace PBR {
-    static long long nShapesCreated = 0;
     Shape::Shape(const Transform* ObjectToWorld, const Transform* WorldToObject,
         bool reverseOrientation)
         : ObjectToWorld(ObjectToWorld),
         WorldToObject(WorldToObject),
         reverseOrientation(reverseOrientation), 
 		transformSwapsHandedness(ObjectToWorld->SwapsHandedness()) {
-        ++nShapesCreated;
+        STAT_INC(Shapes);
     }
     Shape::~Shape() {}
     Bounds3f Shape::WorldBound() const { return (*ObjectToWorld)(ObjectBound()); }
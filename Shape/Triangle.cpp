@@ -4,11 +4,6 @@
 
 namespace PBR {
 
-	static long long nTris = 0;
-	static long long nMeshes = 0;
-	static long long nHits = 0;
-	static long long nTests = 0;
-
 	TriangleMesh::TriangleMesh(
 		const Transform& ObjectToWorld, int nTriangles, const int* vertexIndices,
 		int nVertices, const Point3f* P, const Vector3f* S, const Normal3f* N,
@@ -16,12 +11,12 @@ namespace PBR {
 		: nTriangles(nTriangles),
 		nVertices(nVertices),
 		vertexIndices(vertexIndices, vertexIndices + 3 * nTriangles) {
-		++nMeshes;
-		nTris += nTriangles;
-		triMeshBytes += sizeof(*this) + this->vertexIndices.size() * sizeof(int) +
+		STAT_INC(Meshes);
+		STAT_ADD(Triangles, nTriangles);
+		STAT_ADD(TriangleMeshBytes, sizeof(*this) + this->vertexIndices.size() * sizeof(int) +
 			nVertices * (sizeof(*P) + (N ? sizeof(*N) : 0) +
 				(S ? sizeof(*S) : 0) + (UV ? sizeof(*UV) : 0) +
-				(fIndices ? sizeof(*fIndices) : 0));
+				(fIndices ? sizeof(*fIndices) : 0)));
 
 		// Transform mesh vertices to world space
 		p.reset(new Point3f[nVertices]);
@@ -43,6 +38,16 @@ namespace PBR {
 			faceIndices = std::vector<int>(fIndices, fIndices + nTriangles);
 	}
 
+	void TriangleMesh::SetMotion(const Transform& ObjectToWorld1, const Point3f* P1, const Normal3f* N1) {
+		p1.reset(new Point3f[nVertices]);
+		for (int i = 0; i < nVertices; ++i) p1[i] = ObjectToWorld1(P1[i]);
+		if (n && N1) {
+			n1.reset(new Normal3f[nVertices]);
+			for (int i = 0; i < nVertices; ++i) n1[i] = ObjectToWorld1(N1[i]);
+		}
+		STAT_ADD(TriangleMeshBytes, nVertices * (sizeof(*P1) + (n1 ? sizeof(*N1) : 0)));
+	}
+
 
 	Bounds3f Triangle::ObjectBound() const {
 		// Get triangle vertices in _p0_, _p1_, and _p2_
@@ -52,25 +57,51 @@ namespace PBR {
 		return Union(Bounds3f((*WorldToObject)(p0), (*WorldToObject)(p1)),
 			(*WorldToObject)(p2));
 	}
+	Bounds3f TriangleWorldBound(const TriangleMesh& mesh, const int* v) {
+		const Point3f& p0 = mesh.p[v[0]];
+		const Point3f& p1 = mesh.p[v[1]];
+		const Point3f& p2 = mesh.p[v[2]];
+		Bounds3f bounds = Union(Bounds3f(p0, p1), p2);
+		// ˶񣺶˶˰ΧеĲ
+		if (mesh.HasMotion())
+			bounds = Union(bounds, TriangleWorldBound(mesh, v, 1.f));
+		return bounds;
+	}
+	Bounds3f TriangleWorldBound(const TriangleMesh& mesh, const int* v, float time) {
+		return Union(Bounds3f(mesh.P(v[0], time), mesh.P(v[1], time)), mesh.P(v[2], time));
+	}
 	Bounds3f Triangle::WorldBound() const {
-		// Get triangle vertices in _p0_, _p1_, and _p2_
-		const Point3f& p0 = mesh->p[v[0]];
-		const Point3f& p1 = mesh->p[v[1]];
-		const Point3f& p2 = mesh->p[v[2]];
-		return Union(Bounds3f(p0, p1), p2);
+		return TriangleWorldBound(*mesh, v);
+	}
+	static inline void GetTriangleUVs(const TriangleMesh& mesh, const int* v, Point2f uv[3]) {
+		if (mesh.uv) {
+			uv[0] = mesh.uv[v[0]];
+			uv[1] = mesh.uv[v[1]];
+			uv[2] = mesh.uv[v[2]];
+		}
+		else {
+			uv[0] = Point2f(0, 0);
+			uv[1] = Point2f(1, 0);
+			uv[2] = Point2f(1, 1);
+		}
 	}
-	bool Triangle::Intersect(const Ray& ray, float* tHit, SurfaceInteraction* isect,
-		bool testAlphaTexture) const {
 
-		++nTests;
-		const Point3f& p0 = mesh->p[v[0]];
-		const Point3f& p1 = mesh->p[v[1]];
-		const Point3f& p2 = mesh->p[v[2]];
+	// ˮ󽻲ԣֻ㽻
+	bool TriangleHit(const TriangleMesh& mesh, const int* v, const Ray& ray,
+		float* tHit, float b[3]) {
+		STAT_INC(TriangleTests);
+		// ȡ㣨˶ȡʱ̵λã
+		const Point3f p0 = mesh.P(v[0], ray.time);
+		const Point3f p1 = mesh.P(v[1], ray.time);
+		const Point3f p2 = mesh.P(v[2], ray.time);
+
+		// 󽻣߿ռ
 
+		// ƽƣƵԭƶ
 		Point3f p0t = p0 - Vector3f(ray.o);
 		Point3f p1t = p1 - Vector3f(ray.o);
 		Point3f p2t = p2 - Vector3f(ray.o);
-		
+		// ûʹߵΪz
 		int kz = MaxDimension(Abs(ray.d));
 		int kx = kz + 1;
 		if (kx == 3) kx = 0;
@@ -80,7 +111,7 @@ namespace PBR {
 		p0t = Permute(p0t, kx, ky, kz);
 		p1t = Permute(p1t, kx, ky, kz);
 		p2t = Permute(p2t, kx, ky, kz);
-		
+		// У߶뵽zҲ任
 		float Sx = -d.x / d.z;
 		float Sy = -d.y / d.z;
 		float Sz = 1.f / d.z;
@@ -90,11 +121,10 @@ namespace PBR {
 		p1t.y += Sy * p1t.z;
 		p2t.x += Sx * p2t.z;
 		p2t.y += Sy * p2t.z;
-		
+		// 2D,
 		float e0 = p1t.x * p2t.y - p1t.y * p2t.x;
 		float e1 = p2t.x * p0t.y - p2t.y * p0t.x;
 		float e2 = p0t.x * p1t.y - p0t.y * p1t.x;
-		
 		if (sizeof(float) == sizeof(float) &&
 			(e0 == 0.0f || e1 == 0.0f || e2 == 0.0f)) {
 			double p2txp1ty = (double)p2t.x * (double)p1t.y;
@@ -107,12 +137,12 @@ namespace PBR {
 			double p1typ0tx = (double)p1t.y * (double)p0t.x;
 			e2 = (float)(p1typ0tx - p1txp0ty);
 		}
-		
+		// ͬڲ
 		if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0))
 			return false;
 		float det = e0 + e1 + e2;
 		if (det == 0) return false;
-		
+		// t
 		p0t.z *= Sz;
 		p1t.z *= Sz;
 		p2t.z *= Sz;
@@ -121,15 +151,13 @@ namespace PBR {
 			return false;
 		else if (det > 0 && (tScaled <= 0 || tScaled > ray.tMax * det))
 			return false;
-
-		
 		float invDet = 1 / det;
 		float b0 = e0 * invDet;
 		float b1 = e1 * invDet;
 		float b2 = e2 * invDet;
 		float t = tScaled * invDet;
 
-		
+		//
 		float maxZt = MaxComponent(Abs(Vector3f(p0t.z, p1t.z, p2t.z)));
 		float deltaZ = gamma(3) * maxZt;
 		float maxXt = MaxComponent(Abs(Vector3f(p0t.x, p1t.x, p2t.x)));
@@ -144,10 +172,27 @@ namespace PBR {
 			std::abs(invDet);
 		if (t <= deltaT) return false;
 
+		*tHit = t;
+		b[0] = b0;
+		b[1] = b1;
+		b[2] = b2;
+		STAT_INC(TriangleHits);
+		return true;
+	}
+
+	// ֪꣬SurfaceInteractionuvƫɫߡΧ
+	void TriangleInteraction(const TriangleMesh& mesh, const int* v, int faceIndex,
+		const Ray& ray, const float b[3], SurfaceInteraction* isect,
+		bool reverseOrientation, bool transformSwapsHandedness, const Shape* shape) {
+		const Point3f p0 = mesh.P(v[0], ray.time);
+		const Point3f p1 = mesh.P(v[1], ray.time);
+		const Point3f p2 = mesh.P(v[2], ray.time);
+		float b0 = b[0], b1 = b[1], b2 = b[2];
+
 		// uv
 		Vector3f dpdu, dpdv;
 		Point2f uv[3];
-		GetUVs(uv);
+		GetTriangleUVs(mesh, v, uv);
 		Vector2f duv02 = uv[0] - uv[2], duv12 = uv[1] - uv[2];
 		Vector3f dp02 = p0 - p2, dp12 = p1 - p2;
 		float determinant = duv02[0] * duv12[1] - duv02[1] * duv12[0];
@@ -175,7 +220,7 @@ namespace PBR {
 		// ṹ
 		*isect = SurfaceInteraction(pHit, pError, uvHit, -ray.d, dpdu, dpdv,
 			Normal3f(0, 0, 0), Normal3f(0, 0, 0), ray.time,
-			this, faceIndex);
+			shape, faceIndex);
 
 		// η
 		// ɫ
@@ -184,12 +229,16 @@ namespace PBR {
 			isect->n = isect->shading.n = -isect->n;
 
 		// ģṩ𶥵㷨߻𶥵ʱ
-		if (mesh->n || mesh->s) {
+		if (mesh.n || mesh.s) {
+			// 㷨ߣ˶ȡʱ̵Ĳֵ
+			Normal3f nv[3];
+			if (mesh.n)
+				for (int i = 0; i < 3; ++i) nv[i] = mesh.N(v[i], ray.time);
 			// ֵɫ ns
 			Normal3f ns;
-			if (mesh->n) {
+			if (mesh.n) {
 				// ƽɫԶ㷨ֵ߲
-				ns = (b0 * mesh->n[v[0]] + b1 * mesh->n[v[1]] + b2 * mesh->n[v[2]]);
+				ns = (b0 * nv[0] + b1 * nv[1] + b2 * nv[2]);
 				if (ns.LengthSquared() > 0)
 					ns = Normalize(ns);
 				else
@@ -200,8 +249,8 @@ namespace PBR {
 
 			// ֵɫ ss
 			Vector3f ss;
-			if (mesh->s) {
-				ss = (b0 * mesh->s[v[0]] + b1 * mesh->s[v[1]] + b2 * mesh->s[v[2]]);
+			if (mesh.s) {
+				ss = (b0 * mesh.s[v[0]] + b1 * mesh.s[v[1]] + b2 * mesh.s[v[2]]);
 				if (ss.LengthSquared() > 0)
 					ss = Normalize(ss);
 				else
@@ -221,16 +270,16 @@ namespace PBR {
 
 			// 㷨ƫ dndu, dndv
 			Normal3f dndu, dndv;
-			if (mesh->n) {
+			if (mesh.n) {
 				Vector2f duv02 = uv[0] - uv[2];
 				Vector2f duv12 = uv[1] - uv[2];
-				Normal3f dn1 = mesh->n[v[0]] - mesh->n[v[2]];
-				Normal3f dn2 = mesh->n[v[1]] - mesh->n[v[2]];
+				Normal3f dn1 = nv[0] - nv[2];
+				Normal3f dn2 = nv[1] - nv[2];
 				float determinant = duv02[0] * duv12[1] - duv02[1] * duv12[0];
 				bool degenerateUV = std::abs(determinant) < 1e-8;
 				if (degenerateUV) {				
-					Vector3f dn = Cross(Vector3f(mesh->n[v[2]] - mesh->n[v[0]]),
-						Vector3f(mesh->n[v[1]] - mesh->n[v[0]]));
+					Vector3f dn = Cross(Vector3f(nv[2] - nv[0]),
+						Vector3f(nv[1] - nv[0]));
 					if (dn.LengthSquared() == 0)
 						dndu = dndv = Normal3f(0, 0, 0);
 					else {
@@ -252,101 +301,31 @@ namespace PBR {
 			// 
 			isect->SetShadingGeometry(ss, ts, dndu, dndv, true);
 		}
+	}
 
-		// 
-		*tHit = t;
-		++nHits;
+	bool IntersectTriangle(const TriangleMesh& mesh, const int* v, int faceIndex,
+		const Ray& ray, float* tHit, SurfaceInteraction* isect,
+		bool reverseOrientation, bool transformSwapsHandedness, const Shape* shape) {
+		float b[3];
+		if (!TriangleHit(mesh, v, ray, tHit, b)) return false;
+		TriangleInteraction(mesh, v, faceIndex, ray, b, isect,
+			reverseOrientation, transformSwapsHandedness, shape);
 		return true;
 	}
 
-	bool Triangle::IntersectP(const Ray& ray, bool testAlphaTexture) const {
-		++nTests;
-		// ȡ
-		const Point3f& p0 = mesh->p[v[0]];
-		const Point3f& p1 = mesh->p[v[1]];
-		const Point3f& p2 = mesh->p[v[2]];
-
-		// 󽻣߿ռ
-
-		// ƽƣƵԭƶ
-		Point3f p0t = p0 - Vector3f(ray.o);
-		Point3f p1t = p1 - Vector3f(ray.o);
-		Point3f p2t = p2 - Vector3f(ray.o);
-		// ûʹߵΪz
-		int kz = MaxDimension(Abs(ray.d));
-		int kx = kz + 1;
-		if (kx == 3) kx = 0;
-		int ky = kx + 1;
-		if (ky == 3) ky = 0;
-		Vector3f d = Permute(ray.d, kx, ky, kz);
-		p0t = Permute(p0t, kx, ky, kz);
-		p1t = Permute(p1t, kx, ky, kz);
-		p2t = Permute(p2t, kx, ky, kz);
-		// У߶뵽zҲ任
-		float Sx = -d.x / d.z;
-		float Sy = -d.y / d.z;
-		float Sz = 1.f / d.z;
-		p0t.x += Sx * p0t.z;
-		p0t.y += Sy * p0t.z;
-		p1t.x += Sx * p1t.z;
-		p1t.y += Sy * p1t.z;
-		p2t.x += Sx * p2t.z;
-		p2t.y += Sy * p2t.z;
-		// 2D,
-		float e0 = p1t.x * p2t.y - p1t.y * p2t.x;
-		float e1 = p2t.x * p0t.y - p2t.y * p0t.x;
-		float e2 = p0t.x * p1t.y - p0t.y * p1t.x;
-		if (sizeof(float) == sizeof(float) &&
-			(e0 == 0.0f || e1 == 0.0f || e2 == 0.0f)) {
-			double p2txp1ty = (double)p2t.x * (double)p1t.y;
-			double p2typ1tx = (double)p2t.y * (double)p1t.x;
-			e0 = (float)(p2typ1tx - p2txp1ty);
-			double p0txp2ty = (double)p0t.x * (double)p2t.y;
-			double p0typ2tx = (double)p0t.y * (double)p2t.x;
-			e1 = (float)(p0typ2tx - p0txp2ty);
-			double p1txp0ty = (double)p1t.x * (double)p0t.y;
-			double p1typ0tx = (double)p1t.y * (double)p0t.x;
-			e2 = (float)(p1typ0tx - p1txp0ty);
-		}
-		// ͬڲ
-		if ((e0 < 0 || e1 < 0 || e2 < 0) && (e0 > 0 || e1 > 0 || e2 > 0))
-			return false;
-		float det = e0 + e1 + e2;
-		if (det == 0) return false;
-		// t
-		p0t.z *= Sz;
-		p1t.z *= Sz;
-		p2t.z *= Sz;
-		float tScaled = e0 * p0t.z + e1 * p1t.z + e2 * p2t.z;
-		if (det < 0 && (tScaled >= 0 || tScaled < ray.tMax * det))
-			return false;
-		else if (det > 0 && (tScaled <= 0 || tScaled > ray.tMax * det))
-			return false;
-		float invDet = 1 / det;
-		float b0 = e0 * invDet;
-		float b1 = e1 * invDet;
-		float b2 = e2 * invDet;
-		float t = tScaled * invDet;
-
-		//
-		float maxZt = MaxComponent(Abs(Vector3f(p0t.z, p1t.z, p2t.z)));
-		float deltaZ = gamma(3) * maxZt;
-		float maxXt = MaxComponent(Abs(Vector3f(p0t.x, p1t.x, p2t.x)));
-		float maxYt = MaxComponent(Abs(Vector3f(p0t.y, p1t.y, p2t.y)));
-		float deltaX = gamma(5) * (maxXt + maxZt);
-		float deltaY = gamma(5) * (maxYt + maxZt);
-		float deltaE =
-			2 * (gamma(2) * maxXt * maxYt + deltaY * maxXt + deltaX * maxYt);
-		float maxE = MaxComponent(Abs(Vector3f(e0, e1, e2)));
-		float deltaT = 3 *
-			(gamma(3) * maxE * maxZt + deltaE * maxZt + deltaZ * maxE) *
-			std::abs(invDet);
-		if (t <= deltaT) return false;
-
+	bool IntersectPTriangle(const TriangleMesh& mesh, const int* v, const Ray& ray) {
+		float tHit, b[3];
+		return TriangleHit(mesh, v, ray, &tHit, b);
+	}
 
+	bool Triangle::Intersect(const Ray& ray, float* tHit, SurfaceInteraction* isect,
+		bool testAlphaTexture) const {
+		return IntersectTriangle(*mesh, v, faceIndex, ray, tHit, isect,
+			reverseOrientation, transformSwapsHandedness, this);
+	}
 
-		++nHits;
-		return true;
+	bool Triangle::IntersectP(const Ray& ray, bool testAlphaTexture) const {
+		return IntersectPTriangle(*mesh, v, ray);
 	}
 
 	float Triangle::Area() const {
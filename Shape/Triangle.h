@@ -6,6 +6,7 @@
 #include "Core\Transform.h"
 #include "Core\Geometry.h"
 #include "Shape\Shape.h"
+#include "Core\Stats.h"
 
 namespace PBR {
 	struct TriangleMesh {
@@ -21,8 +22,42 @@ namespace PBR {
 		std::unique_ptr<Vector3f[]> s;
 		std::unique_ptr<Point2f[]> uv;
 		std::vector<int> faceIndices;
+
+		// ؼ֡˶pnΪtime=0ʱλ뷨ߣp1n1ѡΪtime=1ʱģ
+		// м䰴ߵtimeԲֵtime[0, 1]ʱȡ˵
+		std::unique_ptr<Point3f[]> p1;
+		std::unique_ptr<Normal3f[]> n1;
+		// time=1Ĺؼ֡P1빹ʱPһһӦռ䣩N1Ϊգ
+		// ˶ʱͬPһ任
+		void SetMotion(const Transform& ObjectToWorld1, const Point3f* P1, const Normal3f* N1 = nullptr);
+		bool HasMotion() const { return p1 != nullptr; }
+		Point3f P(int i, float time) const {
+			return p1 ? Lerp(Clamp(time, 0, 1), p[i], p1[i]) : p[i];
+		}
+		Normal3f N(int i, float time) const {
+			if (!n1) return n[i];
+			float t = Clamp(time, 0, 1);
+			return (1 - t) * n[i] + t * n1[i];
+		}
 	};
-	static long long triMeshBytes = 0;
+
+	// еΣvİΧ󽻣TriangleTriangleMeshPrimitiveá
+	// 񶥵ռУshapeΪ
+	Bounds3f TriangleWorldBound(const TriangleMesh& mesh, const int* v);
+	// ˶timeʱ̵İΧ
+	Bounds3f TriangleWorldBound(const TriangleMesh& mesh, const int* v, float time);
+	bool IntersectTriangle(const TriangleMesh& mesh, const int* v, int faceIndex,
+		const Ray& ray, float* tHit, SurfaceInteraction* isect,
+		bool reverseOrientation, bool transformSwapsHandedness, const Shape* shape);
+	bool IntersectPTriangle(const TriangleMesh& mesh, const int* v, const Ray& ray);
+	// 󽻲TriangleHitֻˮܲԲt꣬
+	// TriangleInteractionȷٹĽϢ
+	bool TriangleHit(const TriangleMesh& mesh, const int* v, const Ray& ray,
+		float* tHit, float b[3]);
+	void TriangleInteraction(const TriangleMesh& mesh, const int* v, int faceIndex,
+		const Ray& ray, const float b[3], SurfaceInteraction* isect,
+		bool reverseOrientation, bool transformSwapsHandedness, const Shape* shape);
+
 	class Triangle : public Shape {
 	public:
 		Triangle(const Transform* ObjectToWorld, const Transform* WorldToObject,
@@ -30,7 +65,7 @@ namespace PBR {
 			int triNumber)
 			: Shape(ObjectToWorld, WorldToObject, reverseOrientation), mesh(mesh) {
 			v = &mesh->vertexIndices[3 * triNumber];
-			triMeshBytes += sizeof(*this);
+			STAT_ADD(TriangleMeshBytes, sizeof(*this));
 			faceIndex = mesh->faceIndices.size() ? mesh->faceIndices[triNumber] : 0;
 		}
 		Bounds3f ObjectBound() const;
@@ -41,18 +76,6 @@ namespace PBR {
 		float Area() const;
 		Interaction Sample(const Point2f& u, float* pdf) const;
 	private:
-		void GetUVs(Point2f uv[3]) const {
-			if (mesh->uv) {
-				uv[0] = mesh->uv[v[0]];
-				uv[1] = mesh->uv[v[1]];
-				uv[2] = mesh->uv[v[2]];
-			}
-			else {
-				uv[0] = Point2f(0, 0);
-				uv[1] = Point2f(1, 0);
-				uv[2] = Point2f(1, 1);
-			}
-		}
 		std::shared_ptr<TriangleMesh> mesh;
 		const int* v;
 		int faceIndex;
@@ -51,14 +51,20 @@ template <typename Tmemory, typename Treturn>
 std::map<TexInfo, std::unique_ptr<MIPMap<Tmemory>>>
 ImageTexture<Tmemory, Treturn>::textures;
 
+template <typename Tmemory, typename Treturn>
+std::mutex ImageTexture<Tmemory, Treturn>::texturesMutex;
+
 template <typename Tmemory, typename Treturn>
 MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::GetTexture(
 	const std::string &filename, bool doTrilinear, float maxAniso,
 	ImageWrap wrap, float scale, bool gamma) {
 	// 黺
 	TexInfo texInfo(filename, doTrilinear, maxAniso, wrap, scale, gamma);
-	if (textures.find(texInfo) != textures.end())
-		return textures[texInfo].get();
+	{
+		std::lock_guard<std::mutex> lock(texturesMutex);
+		if (textures.find(texInfo) != textures.end())
+			return textures[texInfo].get();
+	}
 
 	// 
 	Point2i resolution;
@@ -95,8 +101,14 @@ MIPMap<Tmemory> *ImageTexture<Tmemory, Treturn>::GetTexture(
 		Tmemory oneVal = scale;
 		mipmap = new MIPMap<Tmemory>(Point2i(1, 1), &oneVal);
 	}
-	// ػ
-	textures[texInfo].reset(mipmap);
+	// ػ棬߳ѾͬһʱʹȴǸ
+	std::lock_guard<std::mutex> lock(texturesMutex);
+	std::unique_ptr<MIPMap<Tmemory>>& cached = textures[texInfo];
+	if (cached) {
+		delete mipmap;
+		return cached.get();
+	}
+	cached.reset(mipmap);
 	return mipmap;
 }
 
@@ -8,6 +8,7 @@
 #include "Core\Spectrum.h"
 #include <map>
 #include <memory>
+#include <mutex>
 
 namespace PBR {
 	// ļͷֱʣͼصɫ
@@ -85,6 +86,8 @@ private:
 	std::unique_ptr<TextureMapping2D> mapping;
 	MIPMap<Tmemory> *mipmap;
 	static std::map<TexInfo, std::unique_ptr<MIPMap<Tmemory>>> textures;
+	// textures߳ͬʱУ
+	static std::mutex texturesMutex;
 };
 
 extern template class ImageTexture<float, float>;
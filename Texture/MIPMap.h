@@ -6,17 +6,14 @@
 #include "Core\Spectrum.h"
 #include "Texture\Texture.h"
 #include "Core\Memory.h"
+#include "Core\Stats.h"
 
 #include <vector>
 #include <string>
+#include <mutex>
 
 namespace PBR {
 
-	// Բ˲ôԲֵôMIPMAPڴ
-	static int64_t nEWALookups = 0;
-	static int64_t nTrilerpLookups = 0;
-	static int64_t mipMapMemory = 0;
-
 // 곬޵Ĳ
 enum class ImageWrap { Repeat, Black, Clamp };
 // ͼ
@@ -168,14 +165,16 @@ MIPMap<T>::MIPMap(const Point2i &res, const T *img, bool doTrilinear,
 		}
 	}
 	//  EWA ˲Ҫõ exp() Ȩ
-	if (weightLut[0] == 0.) {
+	// ߳̿ͬʱMIPMapֻʼһ
+	static std::once_flag weightLutInit;
+	std::call_once(weightLutInit, []() {
 		for (int i = 0; i < WeightLUTSize; ++i) {
 			float alpha = 2;
 			float r2 = float(i) / float(WeightLUTSize - 1);
 			weightLut[i] = std::exp(-alpha * r2) - std::exp(-alpha);
 		}
-	}
-	mipMapMemory += (4 * resolution[0] * resolution[1] * sizeof(T)) / 3;
+	});
+	STAT_ADD(MIPMapBytes, (4 * resolution[0] * resolution[1] * sizeof(T)) / 3);
 }
 
 // ȡ
@@ -205,7 +204,7 @@ const T &MIPMap<T>::Texel(int level, int s, int t) const {
 
 template <typename T>
 T MIPMap<T>::Lookup(const Point2f &st, float width) const {
-	++nTrilerpLookups;
+	STAT_INC(TrilerpLookups);
 	//  width ͨתΪ㼶
 	float level = Levels() - 1 + Log2(std::max(width, (float)1e-8));
 	//  width ģֱӲ߲
@@ -230,7 +229,7 @@ T MIPMap<T>::Lookup(const Point2f &st, Vector2f dst0, Vector2f dst1) const {
 			std::max(std::abs(dst1[0]), std::abs(dst1[1])));
 		return Lookup(st, width);
 	}
-	++nEWALookups;
+	STAT_INC(EWALookups);
 	// Compute ellipse minor and major axes
 	if (dst0.LengthSquared() < dst1.LengthSquared()) std::swap(dst0, dst1);
 	float majorLength = dst0.Length();